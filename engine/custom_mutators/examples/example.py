@@ -185,3 +185,20 @@ def fuzz(buf, add_buf, max_size):
 #     @param filename_orig_queue: File name of the original queue entry
 #     '''
 #     pass
+#
+# def reduce_feedback(result, fault, few_bits, same_site, bitmap_size,
+#                     actual_counts, min_bitmap_size, min_actual_cnts,
+#                     crash_module, crash_symbol, crash_offset, fname):
+#     '''
+#     Called after each decision of save_if_interesting, rejects included
+#
+#     @type few_bits: int
+#     @param few_bits: has_few_bits code of a crash or hang, 0x11-0x1f for a decrease
+#
+#     @type same_site: int
+#     @param same_site: 1 same crash site, 0 changed, 2 not checked
+#
+#     @type fname: str
+#     @param fname: File name of the new queue entry, or None
+#     '''
+#     pass
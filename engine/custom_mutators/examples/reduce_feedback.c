@@ -0,0 +1,111 @@
+// A mutator that only listens: afl_custom_reduce_feedback checks what
+// save_if_interesting reports against what afl-fuzz has, and aborts on
+// the first mismatch. Used by test/test-custom-mutators.sh.
+// needs -I /path/to/AFLplusplus/include
+#include "afl-fuzz.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct my_mutator {
+
+  afl_state_t *afl;
+  u32          queued_items;
+
+  // What was seen, for the summary
+  u64 calls, crashes, hangs, hangs_checked, queued;
+
+} my_mutator_t;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+                                                                        \
+    if (!(cond)) {                                                      \
+                                                                        \
+      fprintf(stderr, "reduce_feedback: '%s' does not hold\n", #cond); \
+      abort();                                                          \
+                                                                        \
+    }                                                                   \
+                                                                        \
+  } while (0)
+
+my_mutator_t *afl_custom_init(afl_state_t *afl, unsigned int seed) {
+
+  (void)seed;
+  my_mutator_t *data = calloc(1, sizeof(my_mutator_t));
+  if (!data) {
+
+    perror("afl_custom_init alloc");
+    return NULL;
+
+  }
+
+  data->afl = afl;
+
+  return data;
+
+}
+
+void afl_custom_reduce_feedback(my_mutator_t *data,
+                                const struct reduce_feedback *fb) {
+
+  afl_state_t *afl = data->afl;
+
+  // The queue may also have grown from syncing or calibration since
+  u32 grown = afl->queued_items - data->queued_items;
+  data->queued_items = afl->queued_items;
+
+  ++data->calls;
+
+  CHECK(fb->result <= 1);
+  CHECK(!fb->few_bits || (fb->few_bits >= 0x10 && fb->few_bits <= 0x1f));
+  CHECK(fb->few_bits >= 0x10 || (!fb->bitmap_size && !fb->actual_counts));
+  CHECK(fb->few_bits < 0x10 || fb->bitmap_size);
+  CHECK(fb->same_site <= 2);
+  CHECK(!fb->crash_module || fb->fault == FSRV_RUN_CRASH);
+  CHECK(!fb->crash_symbol || fb->crash_module);
+  CHECK(fb->min_bitmap_size == afl->min_bitmap_size);
+  CHECK(fb->min_actual_cnts == afl->min_actual_cnts);
+
+  if (fb->result) {
+
+    // Only decreasing crashes are kept, and they become queue_top
+    CHECK(fb->fault == FSRV_RUN_CRASH);
+    CHECK(fb->few_bits > 0x10);
+    CHECK(fb->same_site != 0);
+    CHECK(grown >= 1);
+    CHECK(fb->fname && fb->fname == afl->queue_top->fname);
+    ++data->queued;
+
+  } else {
+
+    CHECK(!fb->fname);
+
+  }
+
+  if (fb->fault == FSRV_RUN_CRASH) { ++data->crashes; }
+  if (fb->fault == FSRV_RUN_TMOUT) {
+
+    ++data->hangs;
+    if (fb->few_bits) { ++data->hangs_checked; }
+
+  }
+
+}
+
+/**
+ * Deinitialize everything
+ *
+ * @param data The data ptr from afl_custom_init
+ */
+void afl_custom_deinit(my_mutator_t *data) {
+
+  fprintf(stderr,
+          "reduce_feedback: %llu calls, %llu crashes, %llu queued, %llu hangs "
+          "(%llu checked)\n",
+          data->calls, data->crashes, data->queued, data->hangs,
+          data->hangs_checked);
+  free(data);
+
+}
+
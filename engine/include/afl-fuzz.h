@@ -45,6 +45,7 @@
 #include "sharedmem.h"
 #include "forkserver.h"
 #include "common.h"
+#include "sampler.h"
 
 #include <stdio.h>
 #include <unistd.h>
@@ -203,7 +204,120 @@ struct queue_entry {
 
   struct queue_entry *mother;           /* queue entry this based on        */
 
+#if IGORFUZZ_FEATURE_ENABLE
+  u64 actual_counts;                    /* Total hit counts at calibration  */
+  u32 decrease_finds;                   /* Entries queued while fuzzing it  */
+  float decrease_recent,                /* The same, decayed per round, and */
+        decrease_rounds;                /* rounds fuzzed, decayed alike     */
+  u64 *lost_edges;                      /* Matrix edges it doesn't touch    */
+  u8   testcase_ref;                    /* Cache hit since the CLOCK hand   */
+  u8  *store_buf;                       /* Its record in the queue store    */
+  u32  name_id;                         /* The id in its file name, for good*/
+  struct influence_map *influence;      /* Matrix edges its bytes remove    */
+  u8   ddmin_done;                      /* Shrunk by ddmin_stage already?   */
+#endif
+
+};
+
+#if IGORFUZZ_FEATURE_ENABLE
+// Copies of the queue_entry fields every whole-queue scan reads, one
+// array per field indexed by queue id, so those scans stay on
+// contiguous memory instead of chasing queue_buf[] pointers.
+struct queue_hot {
+  u64    *exec_us;
+  u32    *bitmap_size, *tc_ref, *n_fuzz_entry;
+  double *weight;
+  bool   *favored, *was_fuzzed, *disabled;
+  u32     size;
+  // Ids written to since the last weighing, each listed once
+  u32    *touched, touched_cnt;
+  bool   *stale;
+};
+
+#define QUEUE_HOT_TOUCH(afl, q)                                  \
+  ((afl)->q_hot.stale[(q)->id]                                   \
+       ? 0                                                       \
+       : ((afl)->q_hot.stale[(q)->id] = 1,                       \
+          (afl)->q_hot.touched[(afl)->q_hot.touched_cnt++] = (q)->id))
+
+// Writes to a field mirrored in queue_hot must go through here.
+#define QUEUE_HOT_SET(afl, q, field, val) \
+  (QUEUE_HOT_TOUCH(afl, q), (q)->field = (afl)->q_hot.field[(q)->id] = (val))
+
+// IGORFUZZ_STORE: queue entries appended to one data file, which stays
+// mapped read-only, and an index of where each of them is.
+struct queue_store {
+  u8  *map;                  // reserved up front, so it never moves
+  u64  reserve;              // bytes reserved for it
+  u64  size;                 // bytes appended so far
+  s32  data_fd, idx_fd;
+  u8  *last_fn, *last;       // the record add_to_queue takes over
+};
+
+// IGORFUZZ_INFLUENCE: the blocks of a queue entry and the matrix edges
+// a probe of each of them removed, as prefix sums to draw blocks from.
+struct influence_map {
+  u32 block_pow2;            // a block has 1 << block_pow2 bytes
+  u32 blocks;
+  u32 cdf[];                 // edges removed by blocks [0, i]
+};
+
+// IGORFUZZ_HAVOC_REDUCE: operators of the reduction havoc profile.
+// Those up to RHAVOC_STRIP only exist in it.
+enum {
+
+  /* 00 */ RHAVOC_DELETE,      /* Delete bytes                     */
+  /* 01 */ RHAVOC_ZERO,        /* Zero a block                     */
+  /* 02 */ RHAVOC_TRUNCATE,    /* Cut the end off                  */
+  /* 03 */ RHAVOC_MINIMAL,     /* Set a number to 0, 1 or half     */
+  /* 04 */ RHAVOC_STRIP,       /* Delete a run of printable bytes  */
+  /* 05 */ RHAVOC_OVERWRITE,   /* Overwrite with a block or a byte */
+  /* 06 */ RHAVOC_FLIP,        /* Flip a bit                       */
+  /* 07 */ RHAVOC_ARITH,       /* Add or subtract                  */
+  /* 08 */ RHAVOC_INTEREST,    /* Set an interesting value         */
+  /* 09 */ RHAVOC_RANDOM,      /* Set a random byte                */
+  /* 10 */ RHAVOC_BYTE,        /* Increment, decrement or invert   */
+  /* 11 */ RHAVOC_SWITCH,      /* Swap two blocks                  */
+  /* 12 */ RHAVOC_CLONE,       /* Clone or insert a block          */
+  /* 13 */ RHAVOC_EXTRAS,      /* Dictionary and splicing          */
+
+  RHAVOC_NUM
+
+};
+
+// The operator mix of the profile, one particle swarm-optimized like
+// MOpt's, and what each operator did since the last update of it.
+struct havoc_reduce {
+  double x[RHAVOC_NUM], v[RHAVOC_NUM];          // position and velocity
+  double L_best[RHAVOC_NUM], eff_best[RHAVOC_NUM];
+  double cdf[RHAVOC_NUM];                       // prefix sums of x
+  u64    uses[RHAVOC_NUM], score[RHAVOC_NUM];   // this period
+  u64    score_total[RHAVOC_NUM];
+  u8     used[RHAVOC_NUM];                      // by the exec at hand
+  u32    execs;
+  s32    g_now;
+};
+
+// What save_if_interesting decided of an exec, handed to the
+// afl_custom_reduce_feedback of custom mutators. It lives in afl_state
+// and is only valid during the call, pointers included.
+struct reduce_feedback {
+  u8        result;          // what save_if_interesting returned
+  u8        fault;           // FSRV_RUN_* it was judged by in the end
+  u8        few_bits;        // has_few_bits of a crash or hang, 0 if not asked
+  u8        same_site;       // 1 same crash site, 0 changed, 2 not checked
+  u32       bitmap_size;     // of the exec, 0 if few_bits < 0x10
+  u64       actual_counts;   // of the exec, 0 if few_bits < 0x10
+  u32       min_bitmap_size; // after the decision
+  u64       min_actual_cnts;
+  const u8 *crash_module;    // crash site of the exec if it was looked
+  const u8 *crash_symbol;    // up, NULL and 0 otherwise
+  u32       crash_offset;
+  const u8 *fname;           // new queue entry, NULL if none
 };
+#else
+#define QUEUE_HOT_SET(afl, q, field, val) ((q)->field = (val))
+#endif
 
 struct extra_data {
 
@@ -221,6 +335,53 @@ struct auto_extra_data {
 
 };
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* Verdicts on a symbolized stack frame */
+
+enum {
+
+  /* 00 */ SYM_FRAME_UNKNOWN,           /* Symbolizer knows nothing         */
+  /* 01 */ SYM_FRAME_NOFUNC,            /* Analyzable but no function name  */
+  /* 02 */ SYM_FRAME_BLOCKED,           /* Function is blacklisted          */
+  /* 03 */ SYM_FRAME_ALLOWED            /* Function may be the crash site   */
+
+};
+
+struct poc_pool;
+
+struct crash_log_buf {
+
+  u8 *data, *fn;
+  u32 len, size;
+  s32 fd;
+
+};
+
+struct sym_cache_entry {
+
+  u64 hash;                             /* Hash of (module, offset), 0=free */
+  u64 stamp;                            /* Module identity on disk          */
+  u8 *module;                           /* Module path                      */
+  u8 *func;                             /* Function name, may be NULL       */
+  u32 offset;                           /* Offset in the module             */
+  u8  verdict;                          /* SYM_FRAME_*                      */
+
+};
+
+struct sym_module {
+
+  u8 *path;                             /* Module path                      */
+  u8  blocked,                          /* No crash site in it at all?      */
+      has_symtab;                       /* Ranges below are usable?         */
+  u32 n_ranges;                         /* Number of blocked ranges         */
+  u64 (*ranges)[2];                     /* Sorted [start, end) of blocked   */
+                                        /* functions from ELF symtab        */
+  u32 n_funcs;                          /* Number of function ranges        */
+  u64 (*funcs)[2];                      /* Same, of all functions           */
+
+};
+#endif
+
 /* Fuzzing stages */
 
 enum {
@@ -247,6 +408,10 @@ enum {
   /* 19 */ STAGE_CUSTOM_MUTATOR,
   /* 20 */ STAGE_COLORIZATION,
   /* 21 */ STAGE_ITS,
+#if IGORFUZZ_FEATURE_ENABLE
+  /* 22 */ STAGE_INFLUENCE,
+  /* 23 */ STAGE_DDMIN,
+#endif
 
   STAGE_NUM_MAX
 
@@ -283,15 +448,16 @@ enum {
 
 enum {
 
-  /* 00 */ EXPLORE, /* AFL default, Exploration-based constant schedule */
-  /* 01 */ MMOPT,   /* Modified MOPT schedule           */
-  /* 02 */ EXPLOIT, /* AFL's exploitation-based const.  */
-  /* 03 */ FAST,    /* Exponential schedule             */
-  /* 04 */ COE,     /* Cut-Off Exponential schedule     */
-  /* 05 */ LIN,     /* Linear schedule                  */
-  /* 06 */ QUAD,    /* Quadratic schedule               */
-  /* 07 */ RARE,    /* Rare edges                       */
-  /* 08 */ SEEK,    /* EXPLORE that ignores timings     */
+  /* 00 */ EXPLORE,  /* AFL default, Exploration-based constant schedule */
+  /* 01 */ MMOPT,    /* Modified MOPT schedule           */
+  /* 02 */ EXPLOIT,  /* AFL's exploitation-based const.  */
+  /* 03 */ DECREASE, /* IgorFuzz, distance below matrix  */
+  /* 04 */ FAST,     /* Exponential schedule             */
+  /* 05 */ COE,      /* Cut-Off Exponential schedule     */
+  /* 06 */ LIN,      /* Linear schedule                  */
+  /* 07 */ QUAD,     /* Quadratic schedule               */
+  /* 08 */ RARE,     /* Rare edges                       */
+  /* 09 */ SEEK,     /* EXPLORE that ignores timings     */
 
   POWER_SCHEDULES_NUM
 
@@ -345,6 +511,7 @@ enum {
   /* 13 */ PY_FUNC_DESCRIBE,
   /* 14 */ PY_FUNC_FUZZ_SEND,
   /* 15 */ PY_FUNC_SPLICE_OPTOUT,
+  /* 16 */ PY_FUNC_REDUCE_FEEDBACK,
   PY_FUNC_COUNT
 
 };
@@ -411,6 +578,20 @@ typedef struct afl_env_vars {
 #if IGORFUZZ_FEATURE_ENABLE
   u8  igorfuzz_nocalstk; //EMERGENCY STOP
   u8 *igorfuzz_toolpath; //Path to symbolizer
+  u8  igorfuzz_lazysym;  //Symbolize only for reporting
+  u8  igorfuzz_edgehits; //Per-edge minimum hit counts
+  u8  igorfuzz_crashtxt; //Also render crash details as text
+  u8 *igorfuzz_plateau;  //Stop after secs[:execs] without decrease
+  u8 *igorfuzz_pareto;   //Disable entries off the Pareto frontier
+  u8  igorfuzz_pareto_move; //And move their files aside
+  u8  igorfuzz_fastcal;  //Calibrate until stable, not for fixed cycles
+  u8  igorfuzz_fenwick;  //Select entries from a Fenwick tree
+  u8  igorfuzz_cache_pin; //Keep matrix and favored testcases cached
+  u8  igorfuzz_store;    //Append the queue to one mapped file
+  u8 *igorfuzz_queue_gc; //Free disabled entries [once there are n]
+  u8  igorfuzz_influence; //Map which bytes remove which matrix edges
+  u8  igorfuzz_ddmin;    //Delta debug each new entry before fuzzing it
+  u8  igorfuzz_havoc_reduce; //Havoc with the reduction operator mix
 #endif
 
   s32 afl_pizza_mode;
@@ -648,6 +829,76 @@ typedef struct afl_state {
   u64 min_actual_cnts;
   // min result of count_bytes maintained for coverage-decrease
   u32 min_bitmap_size;
+  // when either minimum last dropped, for IGORFUZZ_PLATEAU
+  u64 last_decrease_time, last_decrease_execs;
+  // the same in wall clock time, for fuzzer_stats, 0 if never
+  u64 last_decrease_stamp;
+  u64 plateau_ms, plateau_execs;
+  u8  plateau_reached;
+  // Dominated entries IGORFUZZ_PARETO leaves enabled, and those it disabled
+  u32 pareto_reserve, queued_dominated;
+  // Execs spent in calibrate_case, and those IGORFUZZ_FASTCAL spared
+  u64 cal_execs, cal_execs_saved;
+  // hash64 stream state used by classify_few_bits
+  void *sweep_hash_state;
+  // Sorted map positions touched by the matrix, for scoring and culling
+  u32 *matrix_edges, matrix_edges_cnt;
+  // Incremental cull: the picks of the last cull in matrix edge order,
+  // temp_v after each of them, and the first edge whose winner changed
+  u32 *cull_edges;
+  struct queue_entry **cull_winners;
+  u64 *cull_snaps;
+  u32  cull_picks, cull_picks_size, cull_dirty;
+  // Hot fields of queue_buf[] entries, see struct queue_hot
+  struct queue_hot q_hot;
+  // IGORFUZZ_FENWICK: the sampler, queued_items at its last full build,
+  // and the averages create_alias_table last weighed entries with
+  struct sampler sampler;
+  u32    sampler_built;
+  struct {
+    double exec_us, bitmap_size, top_size;
+  } weight_avg;
+  // IGORFUZZ_STORE: where the queue entries of this out_dir go
+  struct queue_store queue_store;
+  // IGORFUZZ_QUEUE_GC: disabled entries that make a collection worth it,
+  // entries collected so far, and the bytes they freed
+  u32 queue_gc_min, queued_collected;
+  u64 queue_gc_bytes;
+  // Sorted word indices still touched in virgin_bits, for has_few_bits
+  u32 *touched_words, touched_words_cnt;
+  u8   touched_words_stale;
+  // Non-zero positions of trace_bits, fresh if calibration just took them
+  u32 *trace_nz, trace_nz_cnt;
+  u8   trace_nz_fresh;
+  // Per-edge minimum raw hit counts, 0 for edges out of the matrix
+  u8  *min_edge_hits;
+  // IGORFUZZ_DDMIN: hashes of the candidates tried, and the execs spared
+  u64 *ddmin_seen;
+  u64  ddmin_cache_hits;
+  // has_few_bits of the last crash save_if_interesting looked at, or 0
+  u8   last_few_bits;
+  // bitmap_size has_few_bits counted last
+  u32  last_bitmap_size;
+  // IGORFUZZ_HAVOC_REDUCE
+  struct havoc_reduce *havoc_reduce;
+  // Handed to afl_custom_reduce_feedback, if any mutator has one
+  struct reduce_feedback reduce_fb;
+  u8   custom_reduce_feedback;
+  // Buffered crash detail log
+  struct crash_log_buf crash_log_jsonl, crash_log_text;
+  // PoCs reduced side by side, see afl-fuzz-pocpool.c
+  struct poc_pool *poc_pool;
+  // out_dir of the whole run, while out_dir follows the current PoC
+  u8 *root_out_dir;
+
+  // (module, offset) -> symbol cache for find_crash_site
+  struct sym_cache_entry *sym_cache;
+  u32 sym_cache_size, sym_cache_cnt;
+  u8  sym_cache_dirty;
+  u64 sym_cache_hits, sym_cache_misses;
+  // modules met in call stacks
+  struct sym_module **sym_modules, *sym_module_last;
+  u32 sym_modules_cnt;
 #endif
 
   s32 cpu_core_count,                   /* CPU core count                   */
@@ -790,6 +1041,14 @@ typedef struct afl_state {
   /* How often did we evict from the cache (for statistics only) */
   u32 q_testcase_evictions;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  /* Next cache slot the CLOCK hand looks at */
+  u32 q_testcase_clock_hand;
+
+  /* Reads the cache did and didn't spare (for statistics only) */
+  u64 q_testcase_hits, q_testcase_misses;
+#endif
+
   /* Refs to each queue entry with cached testcase (for eviction, if cache_count
    * is too large) */
   struct queue_entry **q_testcase_cache;
@@ -1046,6 +1305,22 @@ struct custom_mutator {
    */
   u8 (*afl_custom_queue_new_entry)(void *data, const u8 *filename_new_queue,
                                    const u8 *filename_orig_queue);
+
+#if IGORFUZZ_FEATURE_ENABLE
+  /**
+   * Learn what save_if_interesting decided of the exec just run, rejects
+   * included: the has_few_bits code, bitmap_size and actual_counts of the
+   * exec, the minima and the crash site.
+   *
+   * (Optional)
+   *
+   * @param data pointer returned in afl_custom_init by this custom mutator
+   * @param fb The decision. Owned by afl-fuzz and only valid during the call
+   */
+  void (*afl_custom_reduce_feedback)(void *data,
+                                     const struct reduce_feedback *fb);
+#endif
+
   /**
    * Deinitialize the custom mutator.
    *
@@ -1079,6 +1354,9 @@ u8   trim_case_custom(afl_state_t *, struct queue_entry *q, u8 *in_buf,
                       struct custom_mutator *mutator);
 void run_afl_custom_queue_new_entry(afl_state_t *, struct queue_entry *, u8 *,
                                     u8 *);
+#if IGORFUZZ_FEATURE_ENABLE
+void run_afl_custom_reduce_feedback(afl_state_t *);
+#endif
 
 /* Python */
 #ifdef USE_PYTHON
@@ -1097,6 +1375,9 @@ u8          havoc_mutation_probability_py(void *);
 u8          queue_get_py(void *, const u8 *);
 const char *introspection_py(void *);
 u8          queue_new_entry_py(void *, const u8 *, const u8 *);
+  #if IGORFUZZ_FEATURE_ENABLE
+void        reduce_feedback_py(void *, const struct reduce_feedback *);
+  #endif
 void        splice_optout(void *);
 void        deinit_py(void *);
 
@@ -1111,6 +1392,10 @@ void add_to_queue(afl_state_t *, u8 *, u32, u8);
 void destroy_queue(afl_state_t *);
 void update_bitmap_score(afl_state_t *, struct queue_entry *);
 void cull_queue(afl_state_t *);
+#if IGORFUZZ_FEATURE_ENABLE
+void update_sampler(afl_state_t *);
+u32  queue_gc(afl_state_t *);
+#endif
 u32  calculate_score(afl_state_t *, struct queue_entry *);
 
 /* Bitmap */
@@ -1136,9 +1421,45 @@ u8 has_new_bits(afl_state_t *, u8 *);
 u8 has_new_bits_unclassified(afl_state_t *, u8 *);
 #if IGORFUZZ_FEATURE_ENABLE
 u8   has_few_bits(afl_state_t *, u8 *);
+u8   classify_few_bits(afl_state_t *, u8 *, u64 *);
+void seed_edge_hits(afl_state_t *);
+u32  trace_nonzero(afl_state_t *);
+void mark_var_bytes(afl_state_t *);
+void crash_log_init(afl_state_t *);
+void crash_log_add(afl_state_t *, struct queue_entry *);
+void crash_log_flush(afl_state_t *);
+void crash_log_close(afl_state_t *);
+void poc_pool_init(afl_state_t *);
+void poc_pool_dry_run(afl_state_t *);
+void poc_pool_schedule(afl_state_t *, u32 *, u64 *);
+void poc_pool_destroy(afl_state_t *);
+void poc_pool_converged(afl_state_t *);
+u32  poc_pool_size(afl_state_t *);
+void write_queue_file(afl_state_t *, u8 *, u8 *, u32);
+void rewrite_queue_file(afl_state_t *, struct queue_entry *, u8 *, u32);
+u8  *queue_store_claim(afl_state_t *, u8 *);
+void queue_store_move(afl_state_t *, struct queue_entry *, u8 *);
+void queue_store_export(afl_state_t *);
+void queue_store_evict(struct queue_entry *);
+void queue_store_close(afl_state_t *);
+void queue_store_recover(afl_state_t *, u8 *);
 void find_crash_site(afl_state_t *, u8, u8 **, u8 **, u32 *);
 u8   same_crash_site(afl_state_t *, struct queue_entry *, u8, u8);
+u8   peek_crash_site(afl_state_t *);
+u8   influence_stage(afl_state_t *, u8 *, u32);
+u8   ddmin_stage(afl_state_t *, u8 *, u32);
+void havoc_reduce_init(afl_state_t *);
+void havoc_reduce_account(afl_state_t *);
+u64  mopt_find_weight(afl_state_t *, u64, u32, u64);
 void write_crash_detail(afl_state_t *, struct queue_entry *);
+struct sym_cache_entry *sym_cache_find(afl_state_t *, u8 *, u32);
+struct sym_cache_entry *sym_cache_add(afl_state_t *, u8 *, u32, u8, u8 *);
+void sym_cache_load(afl_state_t *);
+void sym_cache_save(afl_state_t *);
+void sym_cache_destroy(afl_state_t *);
+struct sym_module *sym_module_get(afl_state_t *, u8 *);
+u8   sym_module_blocked_addr(struct sym_module *, u32);
+u8   sym_module_func_addr(struct sym_module *, u32);
 # ifdef SIMPLE_FILES
 # error SIMPLE_FILES is not supported by IgorFuzz 
 # endif
@@ -0,0 +1,53 @@
+/*
+   IgorFuzz - call stack channel header
+   ------------------------------------
+
+   Layout of the shared memory region that afl-igorfuzz-rt fills
+   within __asan_on_error. Every frame is recorded as a raw pair of
+   (module id, offset in module), so afl-fuzz can figure out the
+   crash site without touching the filesystem on each crashing exec.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#ifndef _AFL_CALLSTACK_H
+#define _AFL_CALLSTACK_H
+
+#include "config.h"
+#include "types.h"
+
+struct igorfuzz_frame {
+
+  u32 module_id;                        /* Index into modules[]             */
+  u32 offset;                           /* Offset in virtual mem of module  */
+
+};
+
+struct igorfuzz_stack_map {
+
+  /* Set to IGORFUZZ_CALLSTACK_SHM_MAGIC by the runtime once attached.
+     If it is missing the target still uses the legacy call stack file. */
+  u32 magic;
+
+  /* Number of valid frames of the last report, the innermost first.
+     afl-fuzz sets it to 0 when flushing. */
+  u32 n_frames;
+
+  /* Number of valid module paths. Modules are only appended by the
+     runtime, so the ids stay stable for the whole fuzzing session. */
+  u32 n_modules;
+
+  u32 reserved;
+
+  struct igorfuzz_frame frames[IGORFUZZ_CALLSTACK_SHM_FRAMES];
+  char modules[IGORFUZZ_CALLSTACK_SHM_MODULES][IGORFUZZ_CALLSTACK_SHM_PATHLEN];
+
+};
+
+#endif
+
@@ -30,6 +30,20 @@
 #define IGORFUZZ_CALLSTACK_ENV_SHUTDOWN "IGORFUZZ_NOCALSTK"
 #define IGORFUZZ_CALLSTACK_ENV_TOOLPATH "IGORFUZZ_TOOLPATH"
 #define IGORFUZZ_CALLSTACK_ENV_FILEPATH "IGORFUZZ_FILEPATH"
+#define IGORFUZZ_CALLSTACK_ENV_LAZYSYM  "IGORFUZZ_LAZYSYM"
+#define IGORFUZZ_ENV_EDGEHITS           "IGORFUZZ_EDGEHITS"
+#define IGORFUZZ_ENV_CRASHTXT           "IGORFUZZ_CRASHTXT"
+#define IGORFUZZ_ENV_PLATEAU            "IGORFUZZ_PLATEAU"
+#define IGORFUZZ_ENV_PARETO             "IGORFUZZ_PARETO"
+#define IGORFUZZ_ENV_PARETO_MOVE        "IGORFUZZ_PARETO_MOVE"
+#define IGORFUZZ_ENV_FASTCAL            "IGORFUZZ_FASTCAL"
+#define IGORFUZZ_ENV_FENWICK            "IGORFUZZ_FENWICK"
+#define IGORFUZZ_ENV_CACHE_PIN          "IGORFUZZ_CACHE_PIN"
+#define IGORFUZZ_ENV_STORE              "IGORFUZZ_STORE"
+#define IGORFUZZ_ENV_QUEUE_GC           "IGORFUZZ_QUEUE_GC"
+#define IGORFUZZ_ENV_INFLUENCE          "IGORFUZZ_INFLUENCE"
+#define IGORFUZZ_ENV_DDMIN              "IGORFUZZ_DDMIN"
+#define IGORFUZZ_ENV_HAVOC_REDUCE       "IGORFUZZ_HAVOC_REDUCE"
 #define IGORFUZZ_CALLSTACK_DEFAULT_TOOL "/usr/bin/addr2line"
 #define IGORFUZZ_CALLSTACK_DEFAULT_MODE 0666
 
@@ -41,6 +55,70 @@
 #define IGORFUZZ_CALLSTACK_NUL_TEXT "null"
 #define IGORFUZZ_CALLSTACK_EXACT_MODULE 1
 
+#define IGORFUZZ_CALLSTACK_SHM_ENV_VAR "__IGORFUZZ_CALLSTACK_SHM_ID"
+#define IGORFUZZ_CALLSTACK_SHM_MAGIC   0x49474f52 // "IGOR"
+#define IGORFUZZ_CALLSTACK_SHM_FRAMES  256
+#define IGORFUZZ_CALLSTACK_SHM_MODULES 64
+#define IGORFUZZ_CALLSTACK_SHM_PATHLEN 512
+
+// Block size of the fused crash path sweep over trace_bits, fits in L1
+#define IGORFUZZ_SWEEP_BLOCK_SIZE 4096
+
+// Crash detail log under crashes/, README.txt is the optional text rendering
+#define IGORFUZZ_CRASH_LOG_JSONL  "crash_detail.jsonl"
+#define IGORFUZZ_CRASH_LOG_TEXT   "README.txt"
+#define IGORFUZZ_CRASH_LOG_BUFFER (64 * 1024)
+
+// Time slice (ms) of each PoC when -i is a directory of them
+#define IGORFUZZ_POC_SLICE_MS 2000
+
+// Exit status once IGORFUZZ_PLATEAU stopped the run
+#define IGORFUZZ_PLATEAU_EXIT_CODE 3
+
+// Decay per fuzz_one round of the recent decrease yield -p decrease
+// schedules by, so it looks back about 1 / (1 - this) rounds
+#define IGORFUZZ_DECREASE_DECAY 0.8
+
+// Dominated entries IGORFUZZ_PARETO keeps scheduled, unless it says otherwise
+#define IGORFUZZ_PARETO_RESERVE 8
+
+// Weight updates after which IGORFUZZ_FENWICK builds its tree again,
+// before the rounding of each update adds up
+#define IGORFUZZ_FENWICK_REBUILD 65536
+
+// Identical checksums after which IGORFUZZ_FASTCAL ends a calibration
+#define IGORFUZZ_FASTCAL_STABLE 2
+
+// Testcases above 1/this of the testcase cache are read, not cached
+#define IGORFUZZ_CACHE_ADMIT_DIV 16
+
+// Queue store of IGORFUZZ_STORE under out_dir, and the address space
+// reserved for its data file. A pool of PoCs splits the reserve among
+// its PoCs, but leaves each at least the minimum.
+#define IGORFUZZ_STORE_DATA        "queue.store"
+#define IGORFUZZ_STORE_INDEX       "queue.idx"
+#define IGORFUZZ_STORE_RESERVE     (1ULL << 36)
+#define IGORFUZZ_STORE_RESERVE_MIN (1ULL << 28)
+
+// Disabled entries IGORFUZZ_QUEUE_GC waits for, unless it says otherwise
+#define IGORFUZZ_QUEUE_GC_MIN 64
+
+// Blocks IGORFUZZ_INFLUENCE probes at most per entry, and the percentage
+// of havoc and splice positions drawn from its influence map
+#define IGORFUZZ_INFLUENCE_BLOCKS 256
+#define IGORFUZZ_INFLUENCE_BIAS   75
+
+// Execs IGORFUZZ_DDMIN spends per entry at most, and the slots of its
+// cache of candidates tried (a power of 2)
+#define IGORFUZZ_DDMIN_EXECS 2048
+#define IGORFUZZ_DDMIN_CACHE (1 << 16)
+
+// Havoc execs between two updates of the IGORFUZZ_HAVOC_REDUCE mix
+#define IGORFUZZ_RHAVOC_PERIOD 20000
+
+// What MOpt counts a matrix edge lost for, next to one per find
+#define IGORFUZZ_MOPT_BMS_WEIGHT 4
+
 #define IGORFUZZ_NEW_CRASH_MODE_LV1 1
 #define IGORFUZZ_NEW_CRASH_MODE_LV2 2
 #define IGORFUZZ_NEW_CRASH_MODE_LV3 3
@@ -5,6 +5,17 @@ u32 skim(const u32 *virgin, const u32 *current, const u32 *current_end);
 u32 classify_word(u32 word);
 #if IGORFUZZ_FEATURE_ENABLE
 u16 sum_word(u32 word);
+void decrease_word(u8 *ret, const u32 *current, u32 *virgin, u8 hcn_check);
+u8  skim_decrease(u32 *virgin, const u32 *current, const u32 *current_end,
+                  u8 hcn_check);
+u8  skim_decrease_sparse(u32 *virgin, const u32 *current, u32 *idx, u32 *idx_cnt,
+                         u8 hcn_check);
+u8  skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end);
+u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end);
+u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                   const u8 *current_end);
+u8  classify_decrease(afl_forkserver_t *fsrv, u8 *virgin_map, u32 *bitmap_size,
+                      void *hash_state, u32 *idx, u32 *idx_cnt, u8 *min_hits);
 #endif
 
 inline u32 classify_word(u32 word) {
@@ -127,3 +138,189 @@ inline u32 skim(const u32 *virgin, const u32 *current, const u32 *current_end) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* See coverage-64.h for the details. */
+inline void decrease_word(u8 *ret, const u32 *current, u32 *virgin, u8 hcn_check) {
+
+  if (likely(!(u32)(*virgin + 1))) return;
+
+  if (hcn_check && (*current & *virgin)) *ret |= 1;
+
+  const u32 low7 = 0x7f7f7f7fU;
+  u32 cur_zero = ~(((*current & low7) + low7) | *current | low7);
+  u32 vir_ff = ~*virgin;
+  u32 vir_touched = (((vir_ff & low7) + low7) | vir_ff) & ~low7;
+  u32 gone = cur_zero & vir_touched;
+
+  if (gone) {
+    *virgin |= (gone >> 7) * 0xff;
+    *ret |= 2;
+  }
+
+}
+
+inline u8 skim_decrease(u32 *virgin, const u32 *current, const u32 *current_end,
+                        u8 hcn_check) {
+
+  u8 ret = 0;
+
+  for (; current < current_end; ++virgin, ++current) {
+
+    decrease_word(&ret, current, virgin, hcn_check);
+    if (ret & 1) hcn_check = 0;
+
+  }
+
+  return ret;
+
+}
+
+/* skim_decrease over the words listed in idx only, which must cover every
+ * word of virgin still touched. Words becoming untouched are dropped from
+ * idx in place, so the index shrinks along with the run and stays sorted. */
+inline u8 skim_decrease_sparse(u32 *virgin, const u32 *current, u32 *idx, u32 *idx_cnt,
+                               u8 hcn_check) {
+
+  u32 i, kept = 0;
+  u8  ret = 0;
+
+  for (i = 0; i < *idx_cnt; ++i) {
+
+    u32 w = idx[i];
+
+    decrease_word(&ret, current + w, virgin + w, hcn_check);
+    if (ret & 1) hcn_check = 0;
+
+    if (likely((u32)(virgin[w] + 1))) idx[kept++] = w;
+
+  }
+
+  *idx_cnt = kept;
+  return ret;
+
+}
+
+/* See coverage-64.h for the details. */
+inline u8 skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end) {
+
+  u8 ret = 0;
+
+  for (; raw < raw_end; min_hits += 4, raw += 4) {
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!*(u32 *)raw)) continue;
+
+    for (u32 i = 0; i < 4; ++i) {
+      if (unlikely(raw[i] && raw[i] < min_hits[i])) {
+        min_hits[i] = raw[i];
+        ret = 1;
+      }
+    }
+
+  }
+
+  return ret;
+
+}
+
+/* See coverage-64.h for the details. */
+inline u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end) {
+
+  u32 cnt = 0;
+
+  for (const u8 *cur = map; cur < map_end; cur += 4) {
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!*(u32 *)cur)) continue;
+
+    for (u32 i = 0; i < 4; ++i)
+      if (cur[i]) pos[cnt++] = cur - map + i;
+
+  }
+
+  return cnt;
+
+}
+
+/* See coverage-64.h for the details. */
+inline u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                          const u8 *current_end) {
+
+  u32 cnt = 0;
+
+  for (; current < current_end; var_bytes += 4, virgin += 4, first += 4, current += 4) {
+
+    /* Calibration is mostly stable. */
+    if (likely(*(u32 *)first == *(u32 *)current)) continue;
+
+    for (u32 i = 0; i < 4; ++i) {
+      if (unlikely(!var_bytes[i] && first[i] != current[i])) {
+        var_bytes[i] = 1;
+        virgin[i] = 0;
+        ++cnt;
+      }
+    }
+
+  }
+
+  return cnt;
+
+}
+
+/* classify_counts, count_bytes and skim_decrease fused into one sweep over
+ * trace_bits. The map is walked in blocks small enough to stay in L1, so each
+ * byte is fetched from memory once even if a block is walked more than once.
+ * The fresh-bits flag (bit 0) is always reported, since the hit counts are not
+ * known before the end. With hash_state, classified blocks are also hashed.
+ * With idx, the decrease check is left to skim_decrease_sparse after the sweep.
+ * With min_hits, raw counts are checked by skim_edge_hits before being
+ * classified, and bit 2 of the result tells if any edge got fewer hits. */
+inline u8 classify_decrease(afl_forkserver_t *fsrv, u8 *virgin_map, u32 *bitmap_size,
+                            void *hash_state, u32 *idx, u32 *idx_cnt, u8 *min_hits) {
+
+  const u32 low7 = 0x7f7f7f7fU;
+  u8  *block = fsrv->trace_bits, *end = fsrv->trace_bits + fsrv->map_size;
+  u8  *virgin = virgin_map;
+  u64  hits = 0;
+  u32  bytes = 0;
+  u8   ret = 0;
+
+  for (; block < end; block += IGORFUZZ_SWEEP_BLOCK_SIZE,
+                      virgin += IGORFUZZ_SWEEP_BLOCK_SIZE) {
+
+    u8 *block_end = MIN(block + IGORFUZZ_SWEEP_BLOCK_SIZE, end);
+
+    if (min_hits && skim_edge_hits(min_hits + (block - fsrv->trace_bits), block, block_end))
+      ret |= 4;
+
+    for (u32 *mem = (u32 *)block; mem < (u32 *)block_end; ++mem) {
+
+      /* Optimize for sparse bitmaps. */
+      if (unlikely(*mem)) {
+        hits += sum_word(*mem);
+        bytes += __builtin_popcount((((*mem & low7) + low7) | *mem) & ~low7);
+        *mem = classify_word(*mem);
+      }
+
+    }
+
+    if (!idx)
+      ret |= skim_decrease((u32 *)virgin, (u32 *)block, (u32 *)block_end,
+                           !(ret & 1));
+
+    if (hash_state) hash64_stream_update(hash_state, block, block_end - block);
+
+  }
+
+  if (idx) {
+    ret |= skim_decrease_sparse((u32 *)virgin_map,
+                               (u32 *)fsrv->trace_bits, idx, idx_cnt, 1);
+  }
+
+  fsrv->actual_counts = hits;
+  *bitmap_size = bytes;
+  return ret;
+
+}
+#endif
+
@@ -9,6 +9,17 @@ u32 skim(const u64 *virgin, const u64 *current, const u64 *current_end);
 u64 classify_word(u64 word);
 #if IGORFUZZ_FEATURE_ENABLE
 u32 sum_word(u64 word);
+void decrease_word(u8 *ret, const u64 *current, u64 *virgin, u8 hcn_check);
+u8  skim_decrease(u64 *virgin, const u64 *current, const u64 *current_end,
+                  u8 hcn_check);
+u8  skim_decrease_sparse(u64 *virgin, const u64 *current, u32 *idx, u32 *idx_cnt,
+                         u8 hcn_check);
+u8  skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end);
+u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end);
+u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                   const u8 *current_end);
+u8  classify_decrease(afl_forkserver_t *fsrv, u8 *virgin_map, u32 *bitmap_size,
+                      void *hash_state, u32 *idx, u32 *idx_cnt, u8 *min_hits);
 #endif
 
 inline u64 classify_word(u64 word) {
@@ -209,3 +220,454 @@ inline u32 skim(const u64 *virgin, const u64 *current, const u64 *current_end) {
 
 #endif
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* Looks for coverage-decrease in a word. Now we need to deal with two damn cases:
+ * 1. (*virgin + 1) == 0
+ *    The edges are not touched by testcase matrix. Since coverage-decrease
+ *    is going on, we only care about disappearance of already touched edges.
+ *    So ignore this case to optimize.
+ * 2. (*current & *virgin) == 0
+ *    It's just like which in discover_word - i.e., no bits in current bitmap
+ *    that have not been already cleared from the virgin map - this will almost
+ *    always be the case. But when an edge is not touched anymore, bit-AND also
+ *    gives 0. We don't want to lose this since it's a typical coverage-decrease.
+ * Bytes touched before but untouched now are reset to 0xff in virgin, and ret
+ * gets bit 1 for that. With hcn_check, ret gets bit 0 if current still has bits
+ * not cleared from virgin, which makes decreased hit counts less sensitive. */
+inline void decrease_word(u8 *ret, const u64 *current, u64 *virgin, u8 hcn_check) {
+
+  if (likely(!(u64)(*virgin + 1))) return;
+
+  if (hcn_check && (*current & *virgin)) *ret |= 1;
+
+  // SWAR: 0x80 in each byte of current being zero, and of virgin not being 0xff
+  const u64 low7 = 0x7f7f7f7f7f7f7f7fULL;
+  u64 cur_zero = ~(((*current & low7) + low7) | *current | low7);
+  u64 vir_ff = ~*virgin;
+  u64 vir_touched = (((vir_ff & low7) + low7) | vir_ff) & ~low7;
+  u64 gone = cur_zero & vir_touched;
+
+  if (gone) {
+    *virgin |= (gone >> 7) * 0xff;
+    *ret |= 2;
+  }
+
+}
+
+  #if defined(__AVX512F__) && defined(__AVX512BW__)
+    #define DECREASE_PACK_SIZE 64
+inline u8 skim_decrease(u64 *virgin, const u64 *current, const u64 *current_end,
+                        u8 hcn_check) {
+
+  __m512i ones = _mm512_set1_epi8(-1);
+  u8      ret = 0;
+
+  for (; current < current_end; virgin += 8, current += 8) {
+
+    __m512i   vir = _mm512_loadu_si512(virgin);
+    __mmask64 touched = _mm512_cmpneq_epi8_mask(vir, ones);
+
+    /* Not touched by testcase matrix. */
+    if (likely(!touched)) continue;
+
+    __m512i value = *(__m512i *)current;
+
+    if (hcn_check && (_mm512_cmpneq_epi64_mask(vir, ones) &
+                      _mm512_test_epi64_mask(value, vir))) {
+      ret |= 1;
+      hcn_check = 0;
+    }
+
+    /* Touched bytes which are zero now get reset to 0xff. */
+    __mmask64 gone = _mm512_mask_testn_epi8_mask(touched, value, value);
+    if (unlikely(gone)) {
+      _mm512_storeu_si512(virgin, _mm512_mask_blend_epi8(gone, vir, ones));
+      ret |= 2;
+    }
+
+  }
+
+  return ret;
+
+}
+
+
+/* Edges with fewer raw hits than the per-edge minimum, both being non-zero.
+ * min_hits takes the new counts and 1 is returned if there is any. Untracked
+ * edges have a minimum of 0, so they never compare lower. */
+inline u8 skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end) {
+
+  u8 ret = 0;
+
+  for (; raw < raw_end; min_hits += 64, raw += 64) {
+
+    __m512i value = *(__m512i *)raw;
+    __mmask64 hit = _mm512_test_epi8_mask(value, value);
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!hit)) continue;
+
+    __m512i   mins = _mm512_loadu_si512(min_hits);
+    __mmask64 fewer = _mm512_mask_cmplt_epu8_mask(hit, value, mins);
+
+    if (unlikely(fewer)) {
+      _mm512_storeu_si512(min_hits, _mm512_mask_blend_epi8(fewer, mins, value));
+      ret = 1;
+    }
+
+  }
+
+  return ret;
+
+}
+
+
+/* Positions of the non-zero bytes of map, in ascending order, into pos.
+ * Returns how many there are. */
+inline u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end) {
+
+  u32 cnt = 0;
+
+  for (const u8 *cur = map; cur < map_end; cur += 64) {
+
+    __m512i value = *(__m512i *)cur;
+    u64     hit = _mm512_test_epi8_mask(value, value);
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!hit)) continue;
+
+    for (u32 base = cur - map; hit; hit &= hit - 1)
+      pos[cnt++] = base + __builtin_ctzll(hit);
+
+  }
+
+  return cnt;
+
+}
+
+/* Bytes differing between the first trace of calibration and the current
+ * one become variable: var_bytes gets 1 and virgin gets 0 for them. Returns
+ * how many were not variable before. */
+inline u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                          const u8 *current_end) {
+
+  u32 cnt = 0;
+
+  for (; current < current_end; var_bytes += 64, virgin += 64, first += 64, current += 64) {
+
+    __mmask64 diff = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(first), *(__m512i *)current);
+
+    /* Calibration is mostly stable. */
+    if (likely(!diff)) continue;
+
+    __m512i var = _mm512_loadu_si512(var_bytes);
+    diff = _mm512_mask_testn_epi8_mask(diff, var, var);
+    if (!diff) continue;
+
+    _mm512_storeu_si512(var_bytes, _mm512_mask_blend_epi8(diff, var, _mm512_set1_epi8(1)));
+    _mm512_storeu_si512(virgin, _mm512_maskz_mov_epi8(~diff, _mm512_loadu_si512(virgin)));
+    cnt += __builtin_popcountll(diff);
+
+  }
+
+  return cnt;
+
+}
+  #endif
+
+  #if !defined(DECREASE_PACK_SIZE) && defined(__AVX2__)
+    #define DECREASE_PACK_SIZE 32
+inline u8 skim_decrease(u64 *virgin, const u64 *current, const u64 *current_end,
+                        u8 hcn_check) {
+
+  __m256i ones = _mm256_set1_epi8(-1);
+  __m256i zeroes = _mm256_setzero_si256();
+  u8      ret = 0;
+
+  for (; current < current_end; virgin += 4, current += 4) {
+
+    __m256i vir = _mm256_loadu_si256((__m256i *)virgin);
+
+    /* Not touched by testcase matrix. */
+    if (likely(_mm256_testc_si256(vir, ones))) continue;
+
+    __m256i value = *(__m256i *)current;
+
+    if (hcn_check) {
+      __m256i skip = _mm256_or_si256(
+          _mm256_cmpeq_epi64(vir, ones),
+          _mm256_cmpeq_epi64(_mm256_and_si256(value, vir), zeroes));
+      if ((u32)_mm256_movemask_epi8(skip) != (u32)-1) {
+        ret |= 1;
+        hcn_check = 0;
+      }
+    }
+
+    /* Touched bytes which are zero now get reset to 0xff. */
+    __m256i gone = _mm256_andnot_si256(_mm256_cmpeq_epi8(vir, ones),
+                                       _mm256_cmpeq_epi8(value, zeroes));
+    if (unlikely(!_mm256_testz_si256(gone, gone))) {
+      _mm256_storeu_si256((__m256i *)virgin, _mm256_blendv_epi8(vir, ones, gone));
+      ret |= 2;
+    }
+
+  }
+
+  return ret;
+
+}
+
+
+inline u8 skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end) {
+
+  __m256i zeroes = _mm256_setzero_si256();
+  u8      ret = 0;
+
+  for (; raw < raw_end; min_hits += 32, raw += 32) {
+
+    __m256i value = *(__m256i *)raw;
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(_mm256_testz_si256(value, value))) continue;
+
+    __m256i mins = _mm256_loadu_si256((__m256i *)min_hits);
+    /* value < mins means max(value, mins) != value, and 0 is never fewer */
+    __m256i same = _mm256_or_si256(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(value, mins), value),
+        _mm256_cmpeq_epi8(value, zeroes));
+
+    if (unlikely((u32)_mm256_movemask_epi8(same) != (u32)-1)) {
+      _mm256_storeu_si256((__m256i *)min_hits, _mm256_blendv_epi8(value, mins, same));
+      ret = 1;
+    }
+
+  }
+
+  return ret;
+
+}
+
+
+inline u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end) {
+
+  __m256i zeroes = _mm256_setzero_si256();
+  u32     cnt = 0;
+
+  for (const u8 *cur = map; cur < map_end; cur += 32) {
+
+    __m256i value = *(__m256i *)cur;
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(_mm256_testz_si256(value, value))) continue;
+
+    u32 hit = ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, zeroes));
+    for (u32 base = cur - map; hit; hit &= hit - 1)
+      pos[cnt++] = base + __builtin_ctz(hit);
+
+  }
+
+  return cnt;
+
+}
+
+
+inline u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                          const u8 *current_end) {
+
+  __m256i zeroes = _mm256_setzero_si256();
+  u32     cnt = 0;
+
+  for (; current < current_end; var_bytes += 32, virgin += 32, first += 32, current += 32) {
+
+    __m256i value = *(__m256i *)current;
+    __m256i same = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)first), value);
+
+    /* Calibration is mostly stable. */
+    if (likely((u32)_mm256_movemask_epi8(same) == (u32)-1)) continue;
+
+    __m256i var = _mm256_loadu_si256((__m256i *)var_bytes);
+    __m256i diff = _mm256_andnot_si256(same, _mm256_cmpeq_epi8(var, zeroes));
+    u32     mask = (u32)_mm256_movemask_epi8(diff);
+    if (!mask) continue;
+
+    _mm256_storeu_si256((__m256i *)var_bytes,
+                        _mm256_blendv_epi8(var, _mm256_set1_epi8(1), diff));
+    _mm256_storeu_si256((__m256i *)virgin,
+                        _mm256_andnot_si256(diff, _mm256_loadu_si256((__m256i *)virgin)));
+    cnt += __builtin_popcount(mask);
+
+  }
+
+  return cnt;
+
+}
+  #endif
+
+  #if !defined(DECREASE_PACK_SIZE)
+    #define DECREASE_PACK_SIZE 8
+inline u8 skim_decrease(u64 *virgin, const u64 *current, const u64 *current_end,
+                        u8 hcn_check) {
+
+  u8 ret = 0;
+
+  for (; current < current_end; ++virgin, ++current) {
+
+    decrease_word(&ret, current, virgin, hcn_check);
+    if (ret & 1) hcn_check = 0;
+
+  }
+
+  return ret;
+
+}
+
+
+inline u8 skim_edge_hits(u8 *min_hits, const u8 *raw, const u8 *raw_end) {
+
+  u8 ret = 0;
+
+  for (; raw < raw_end; min_hits += 8, raw += 8) {
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!*(u64 *)raw)) continue;
+
+    for (u32 i = 0; i < 8; ++i) {
+      if (unlikely(raw[i] && raw[i] < min_hits[i])) {
+        min_hits[i] = raw[i];
+        ret = 1;
+      }
+    }
+
+  }
+
+  return ret;
+
+}
+
+
+inline u32 skim_nonzero(u32 *pos, const u8 *map, const u8 *map_end) {
+
+  u32 cnt = 0;
+
+  for (const u8 *cur = map; cur < map_end; cur += 8) {
+
+    /* Optimize for sparse bitmaps. */
+    if (likely(!*(u64 *)cur)) continue;
+
+    for (u32 i = 0; i < 8; ++i)
+      if (cur[i]) pos[cnt++] = cur - map + i;
+
+  }
+
+  return cnt;
+
+}
+
+
+inline u32 skim_var_bytes(u8 *var_bytes, u8 *virgin, const u8 *first, const u8 *current,
+                          const u8 *current_end) {
+
+  u32 cnt = 0;
+
+  for (; current < current_end; var_bytes += 8, virgin += 8, first += 8, current += 8) {
+
+    /* Calibration is mostly stable. */
+    if (likely(*(u64 *)first == *(u64 *)current)) continue;
+
+    for (u32 i = 0; i < 8; ++i) {
+      if (unlikely(!var_bytes[i] && first[i] != current[i])) {
+        var_bytes[i] = 1;
+        virgin[i] = 0;
+        ++cnt;
+      }
+    }
+
+  }
+
+  return cnt;
+
+}
+  #endif
+
+/* skim_decrease over the words listed in idx only, which must cover every
+ * word of virgin still touched. Words becoming untouched are dropped from
+ * idx in place, so the index shrinks along with the run and stays sorted. */
+inline u8 skim_decrease_sparse(u64 *virgin, const u64 *current, u32 *idx, u32 *idx_cnt,
+                               u8 hcn_check) {
+
+  u32 i, kept = 0;
+  u8  ret = 0;
+
+  for (i = 0; i < *idx_cnt; ++i) {
+
+    u32 w = idx[i];
+
+    decrease_word(&ret, current + w, virgin + w, hcn_check);
+    if (ret & 1) hcn_check = 0;
+
+    if (likely((u64)(virgin[w] + 1))) idx[kept++] = w;
+
+  }
+
+  *idx_cnt = kept;
+  return ret;
+
+}
+
+/* classify_counts, count_bytes and skim_decrease fused into one sweep over
+ * trace_bits. The map is walked in blocks small enough to stay in L1, so each
+ * byte is fetched from memory once even if a block is walked more than once.
+ * The fresh-bits flag (bit 0) is always reported, since the hit counts are not
+ * known before the end. With hash_state, classified blocks are also hashed.
+ * With idx, the decrease check is left to skim_decrease_sparse after the sweep.
+ * With min_hits, raw counts are checked by skim_edge_hits before being
+ * classified, and bit 2 of the result tells if any edge got fewer hits. */
+inline u8 classify_decrease(afl_forkserver_t *fsrv, u8 *virgin_map, u32 *bitmap_size,
+                            void *hash_state, u32 *idx, u32 *idx_cnt, u8 *min_hits) {
+
+  const u64 low7 = 0x7f7f7f7f7f7f7f7fULL;
+  u8  *block = fsrv->trace_bits, *end = fsrv->trace_bits + fsrv->map_size;
+  u8  *virgin = virgin_map;
+  u64  hits = 0;
+  u32  bytes = 0;
+  u8   ret = 0;
+
+  for (; block < end; block += IGORFUZZ_SWEEP_BLOCK_SIZE,
+                      virgin += IGORFUZZ_SWEEP_BLOCK_SIZE) {
+
+    u8 *block_end = MIN(block + IGORFUZZ_SWEEP_BLOCK_SIZE, end);
+
+    if (min_hits && skim_edge_hits(min_hits + (block - fsrv->trace_bits), block, block_end))
+      ret |= 4;
+
+    for (u64 *mem = (u64 *)block; mem < (u64 *)block_end; ++mem) {
+
+      /* Optimize for sparse bitmaps. */
+      if (unlikely(*mem)) {
+        hits += sum_word(*mem);
+        bytes += __builtin_popcountll((((*mem & low7) + low7) | *mem) & ~low7);
+        *mem = classify_word(*mem);
+      }
+
+    }
+
+    if (!idx)
+      ret |= skim_decrease((u64 *)virgin, (u64 *)block, (u64 *)block_end,
+                           !(ret & 1));
+
+    if (hash_state) hash64_stream_update(hash_state, block, block_end - block);
+
+  }
+
+  if (idx) {
+    ret |= skim_decrease_sparse((u64 *)virgin_map,
+                               (u64 *)fsrv->trace_bits, idx, idx_cnt, 1);
+  }
+
+  fsrv->actual_counts = hits;
+  *bitmap_size = bytes;
+  return ret;
+
+}
+#endif
+
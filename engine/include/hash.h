@@ -33,6 +33,13 @@
 u32 hash32(u8 *key, u32 len, u32 seed);
 u64 hash64(u8 *key, u32 len, u64 seed);
 
+/* Streaming flavour of hash64(), gives the same value for the same bytes */
+void *hash64_stream_new(void);
+void  hash64_stream_free(void *state);
+void  hash64_stream_reset(void *state);
+void  hash64_stream_update(void *state, u8 *key, u32 len);
+u64   hash64_stream_digest(void *state);
+
 #if 0
 
 The following code is disabled because xxh3 is 30% faster
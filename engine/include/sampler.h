@@ -0,0 +1,165 @@
+/*
+   IgorFuzz - weighted queue sampler
+   ---------------------------------
+
+   A Fenwick tree over the selection weights of queue entries. It draws
+   entries with the same probabilities as the alias table built by
+   create_alias_table, but a weight changes and an entry joins in
+   O(log n) rather than with an O(n) rebuild of the whole table.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#ifndef _AFL_SAMPLER_H
+#define _AFL_SAMPLER_H
+
+#include "types.h"
+#include "alloc-inl.h"
+
+struct sampler {
+
+  double *tree;                         /* 1-based, tree[i] sums the w of   */
+                                        /* ids [i - lowbit(i), i)           */
+  double *w;                            /* Current weight of each id        */
+  double  total;                        /* Sum of all of w                  */
+  u32     cnt,                          /* Ids in the tree                  */
+      size,                             /* Ids there is room for            */
+      live,                             /* Ids of weight > 0                */
+      updates;                          /* sampler_set calls since build    */
+
+};
+
+static inline void sampler_grow(struct sampler *s, u32 cnt) {
+
+  if (likely(cnt <= s->size)) { return; }
+
+  while (s->size < cnt) {
+
+    s->size = s->size ? s->size * 2 : 64;
+
+  }
+
+  s->tree = (double *)ck_realloc(s->tree, (s->size + 1) * sizeof(double));
+  s->w = (double *)ck_realloc(s->w, s->size * sizeof(double));
+
+}
+
+/* Take the weights of ids [0, cnt) at once, in O(cnt). */
+
+static inline void sampler_build(struct sampler *s, const double *w, u32 cnt) {
+
+  u32 i, j;
+
+  sampler_grow(s, cnt);
+  memcpy(s->w, w, cnt * sizeof(double));
+
+  s->tree[0] = 0;
+  s->total = 0;
+  s->live = 0;
+  s->updates = 0;
+  for (i = 1; i <= cnt; ++i) {
+
+    s->tree[i] = w[i - 1];
+    s->total += w[i - 1];
+    s->live += w[i - 1] > 0;
+
+  }
+
+  for (i = 1; i <= cnt; ++i) {
+
+    j = i + (i & -i);
+    if (j <= cnt) { s->tree[j] += s->tree[i]; }
+
+  }
+
+  s->cnt = cnt;
+
+}
+
+/* Append the next id with weight w. Its node covers itself and the
+   nodes i - 1, i - 2, i - 4, ... below its lowest set bit. */
+
+static inline void sampler_push(struct sampler *s, double w) {
+
+  u32 i = s->cnt + 1, k;
+
+  sampler_grow(s, i);
+  s->w[s->cnt] = w;
+  s->tree[i] = w;
+  s->total += w;
+  s->live += w > 0;
+
+  for (k = 1; k < (i & -i); k <<= 1) {
+
+    s->tree[i] += s->tree[i - k];
+
+  }
+
+  s->cnt = i;
+
+}
+
+static inline void sampler_set(struct sampler *s, u32 id, double w) {
+
+  double delta = w - s->w[id];
+  u32    i;
+
+  if (delta == 0) { return; }
+  s->live += (w > 0) - (s->w[id] > 0);
+  s->w[id] = w;
+  s->total += delta;
+  ++s->updates;
+
+  for (i = id + 1; i <= s->cnt; i += i & -i) {
+
+    s->tree[i] += delta;
+
+  }
+
+}
+
+/* Draw an id for r in [0, 1). Ids of weight 0 are never drawn. Rounding
+   may leave r * total at or past the last prefix sum, and the updates
+   since the build may leave a sum a little off, so the walk can end on
+   an id of weight 0 next to the one meant. Then cnt is returned, out of
+   range, and the caller should draw again. */
+
+static inline u32 sampler_pick(struct sampler *s, double r) {
+
+  double target = r * s->total;
+  u32    pos = 0, step;
+
+  if (unlikely(!s->cnt)) { return 0; }
+
+  for (step = 1U << (31 - __builtin_clz(s->cnt)); step; step >>= 1) {
+
+    if (pos + step <= s->cnt && s->tree[pos + step] <= target) {
+
+      pos += step;
+      target -= s->tree[pos];
+
+    }
+
+  }
+
+  if (unlikely(pos < s->cnt && !(s->w[pos] > 0))) { return s->cnt; }
+
+  return pos;
+
+}
+
+static inline void sampler_free(struct sampler *s) {
+
+  ck_free(s->tree);
+  ck_free(s->w);
+  memset(s, 0, sizeof(struct sampler));
+
+}
+
+#endif
+
@@ -28,6 +28,7 @@
 #ifndef __AFL_SHAREDMEM_H
 #define __AFL_SHAREDMEM_H
 
+#include "config.h"
 #include "types.h"
 
 typedef struct sharedmem {
@@ -54,6 +55,17 @@ typedef struct sharedmem {
   int             shmemfuzz_mode;
   struct cmp_map *cmp_map;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  int                        callstack_mode;
+  struct igorfuzz_stack_map *stack_map;    /* crash frames of the last run */
+  #ifdef USEMMAP
+  int  callstack_g_shm_fd;
+  char callstack_g_shm_file_path[L_tmpnam];
+  #else
+  s32 callstack_shm_id;
+  #endif
+#endif
+
 } sharedmem_t;
 
 u8  *afl_shm_init(sharedmem_t *, size_t, unsigned char non_instrumented_mode);
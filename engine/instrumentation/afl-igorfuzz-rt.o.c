@@ -1,27 +1,122 @@
 #include "config.h"
 #include "types.h"
+#include "callstack.h"
 
 #include <sanitizer/common_interface_defs.h>
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <execinfo.h>
+
+#ifdef USEMMAP
+  #include <sys/mman.h>
+#else
+  #include <sys/ipc.h>
+  #include <sys/shm.h>
+#endif
+
+/* Call stack channel shared with afl-fuzz. Stays NULL if afl-fuzz
+   doesn't advertise one, then we fall back to the call stack file. */
+static struct igorfuzz_stack_map *__afl_igorfuzz_map;
+
+__attribute__((constructor)) static void __afl_igorfuzz_map_shm(void)
+{
+  char *id_str = getenv(IGORFUZZ_CALLSTACK_SHM_ENV_VAR);
+  if (!id_str) { return; }
+
+  struct igorfuzz_stack_map *map;
+
+#ifdef USEMMAP
+  int shm_fd = shm_open(id_str, O_RDWR, DEFAULT_PERMISSION);
+  if (shm_fd == -1) { return; }
+
+  map = mmap(0, sizeof(struct igorfuzz_stack_map), PROT_READ | PROT_WRITE,
+             MAP_SHARED, shm_fd, 0);
+  close(shm_fd);
+  if (map == MAP_FAILED) { return; }
+#else
+  map = shmat(atoi(id_str), NULL, 0);
+  if (map == (void *)-1) { return; }
+#endif
+
+  // The first backtrace() loads libgcc's unwinder, which allocates and
+  // takes the loader lock. Get it done here, not inside an error report.
+  void *prime[1];
+  backtrace(prime, 1);
+
+  // Tell afl-fuzz that frames will arrive through shared memory
+  map->magic = IGORFUZZ_CALLSTACK_SHM_MAGIC;
+  __afl_igorfuzz_map = map;
+}
+
+/* Look up (or append) module path in the module table of the channel. */
+static u32 __afl_igorfuzz_module_id(struct igorfuzz_stack_map *map, char *path)
+{
+  u32 i;
+  for (i = 0; i < map->n_modules; ++i) {
+    if (!strcmp(map->modules[i], path)) { return i; }
+  }
+  if (map->n_modules >= IGORFUZZ_CALLSTACK_SHM_MODULES) { return (u32)-1; }
+
+  // path comes from a buffer of the same size and is always terminated
+  memcpy(map->modules[i], path, IGORFUZZ_CALLSTACK_SHM_PATHLEN);
+  map->n_modules = i + 1;
+  return i;
+}
+
+/* Record raw frames without any formatting or file I/O. Frames of our
+   own and of the sanitizer runtime are kept, just like those printed by
+   __sanitizer_print_stack_trace, and afl-fuzz drops them later. */
+static void
+__afl_igorfuzz_write_frames(struct igorfuzz_stack_map *map)
+{
+  void *pcs[IGORFUZZ_CALLSTACK_SHM_FRAMES];
+  char  path[IGORFUZZ_CALLSTACK_SHM_PATHLEN];
+  void *offset;
+  u32   n_frames = 0;
+
+  int n_pcs = backtrace(pcs, IGORFUZZ_CALLSTACK_SHM_FRAMES);
+
+  for (int i = 0; i < n_pcs; ++i) {
+    // Same as ASan, point to the call instruction instead of the return address
+    void *pc = (void *)((uintptr_t)pcs[i] - 1);
+    if (!__sanitizer_get_module_and_offset_for_pc(pc, path, sizeof(path), &offset))
+      { continue; }
+
+    u32 module_id = __afl_igorfuzz_module_id(map, path);
+    if (module_id == (u32)-1) { continue; }
+
+    map->frames[n_frames].module_id = module_id;
+    map->frames[n_frames].offset = (u32)(uintptr_t)offset;
+    ++n_frames;
+  }
+
+  map->n_frames = n_frames;
+}
 
 /**
  * https://github.com/llvm/llvm-project/blob/main/compiler-rt/include/sanitizer/asan_interface.h
  * void __asan_on_error(void);
- * 
+ *
  * https://github.com/llvm/llvm-project/blob/main/compiler-rt/lib/asan/asan_report.cpp
  * SANITIZER_INTERFACE_WEAK_DEF(void, __asan_on_error, void) {}
 */
 void __asan_on_error(void)
 {
+  if (__afl_igorfuzz_map) {
+    __afl_igorfuzz_write_frames(__afl_igorfuzz_map);
+    return;
+  }
+
   char *__afl_igorfuzz_fpath = getenv(IGORFUZZ_CALLSTACK_ENV_FILEPATH);
   if (!__afl_igorfuzz_fpath) { return; }
 
   int __afl_igorfuzz_fd = open(
     __afl_igorfuzz_fpath,
-    O_WRONLY | O_CREAT | O_TRUNC, 
+    O_WRONLY | O_CREAT | O_TRUNC,
     IGORFUZZ_CALLSTACK_DEFAULT_MODE
   );
   if (__afl_igorfuzz_fd < 0) { return; }
@@ -30,6 +30,7 @@
 #endif
 
 #if IGORFUZZ_FEATURE_ENABLE
+  #include "callstack.h"
   #include "sanitizer_symbolizer_tool.h"
 #endif
 
@@ -324,6 +325,18 @@ u8 *describe_op(afl_state_t *afl, u8 new_bits, size_t max_description_len) {
 
   } else {
 
+#if IGORFUZZ_FEATURE_ENABLE
+    // Ids move down when the queue is collected, names of files don't
+    sprintf(ret, "src:%06u",
+            afl->queue_cur ? afl->queue_cur->name_id : afl->current_entry);
+
+    if (afl->splicing_with >= 0) {
+
+      sprintf(ret + strlen(ret), "+%06u",
+              afl->queue_buf[afl->splicing_with]->name_id);
+
+    }
+#else
     sprintf(ret, "src:%06u", afl->current_entry);
 
     if (afl->splicing_with >= 0) {
@@ -331,6 +344,7 @@ u8 *describe_op(afl_state_t *afl, u8 new_bits, size_t max_description_len) {
       sprintf(ret + strlen(ret), "+%06d", afl->splicing_with);
 
     }
+#endif
 
     sprintf(ret + strlen(ret), ",time:%llu,execs:%llu",
             get_cur_time() + afl->prev_run_time - afl->start_time,
@@ -396,9 +410,10 @@ u8 *describe_op(afl_state_t *afl, u8 new_bits, size_t max_description_len) {
   if (is_timeout) { strcat(ret, ",+tout"); }
 
 #if IGORFUZZ_FEATURE_ENABLE
-  switch (new_bits)
+  switch (new_bits & 0xf7)
   {
   case 0x02:  strcat(ret, ",+cov"); break;
+  case 0x10:  if (new_bits & 0x08) { strcat(ret, ",-xxx"); } break;
   case 0x11:  strcat(ret, ",-xxh"); break;
   case 0x12:  strcat(ret, ",-xcx"); break;
   case 0x13:  strcat(ret, ",-xch"); break;
@@ -408,6 +423,8 @@ u8 *describe_op(afl_state_t *afl, u8 new_bits, size_t max_description_len) {
   case 0x17:  strcat(ret, ",-bch"); break;
   default  :                        break;
   }
+  // Some edge gets fewer hits, e.g. -bche
+  if (new_bits > 0x10 && (new_bits & 0x08)) { strcat(ret, "e"); }
 #else
   if (new_bits == 2) { strcat(ret, ",+cov"); }
 #endif // IGORFUZZ_FEATURE_ENABLE
@@ -478,6 +495,70 @@ void write_crash_readme(afl_state_t *afl) {
 
 #if IGORFUZZ_FEATURE_ENABLE
 
+/**
+ * (Re)build the index of words in virgin_bits still
+ * touched - i.e. not all 0xff. After the matrix is born
+ * it only shrinks, unless someone else writes virgin_bits
+ * and marks it stale (e.g. variable bytes in calibration).
+*/
+static void build_touched_words(afl_state_t *afl) {
+
+#ifdef WORD_SIZE_64
+  u64 *virgin = (u64 *)afl->virgin_bits;
+  u32  i, n = afl->fsrv.map_size >> 3;
+#else
+  u32 *virgin = (u32 *)afl->virgin_bits;
+  u32  i, n = afl->fsrv.map_size >> 2;
+#endif
+
+  afl->touched_words_cnt = 0;
+  for (i = 0; i < n; ++i) {
+    if (virgin[i] + 1) { ++afl->touched_words_cnt; }
+  }
+
+  afl->touched_words = ck_realloc(afl->touched_words, 
+                                  MAX(afl->touched_words_cnt, 1U) * sizeof(u32));
+  afl->touched_words_cnt = 0;
+  for (i = 0; i < n; ++i) {
+    if (virgin[i] + 1) { afl->touched_words[afl->touched_words_cnt++] = i; }
+  }
+
+  afl->touched_words_stale = 0;
+}
+
+/**
+ * Compose the result code of has_few_bits from the
+ * bitmap_size of current map and the decrease flags
+ * given by skim_decrease.
+*/
+static inline u8 few_bits_code(afl_state_t *afl, u32 cur_bitmap_size, u8 dec) {
+
+  u8 bms_decrease = 0; // whether bitmap_size gets decreased
+  u8 cov_decrease = 0; // whether at least one edge is no longer hit
+  u8 hcn_decrease = 0; // whether the total hit counts gets decreased
+  u8 ehd_decrease = 0; // whether an edge gets fewer hits than ever
+  
+  u8 ret = 0x10; // ret < 0x10 means return as has_new_bits
+
+  if (cur_bitmap_size < afl->min_bitmap_size)
+    bms_decrease = 1;
+  afl->last_bitmap_size = cur_bitmap_size;
+
+  // If there is a touched byte being untouched now, it will mean
+  // there is a path disappeared. virgin_bits has been updated then.
+  cov_decrease = (dec >> 1) & 1;
+  hcn_decrease = dec & 1;
+  ehd_decrease = (dec >> 2) & 1;
+
+  if (cov_decrease) afl->bitmap_changed = 1;
+
+  ret += ehd_decrease<<3;
+  ret += bms_decrease<<2;
+  ret += cov_decrease<<1;
+  ret += hcn_decrease;
+  return ret; // should be in [0x10 , 0x1f]
+}
+
 /**
  * Check if the current execution path brings anything few to the table.
  * It will change nothing but the virgin bits - reset a tuple to virgin
@@ -493,6 +574,8 @@ void write_crash_readme(afl_state_t *afl) {
  * 0   1   0    ---->  0x12
  * 0   0   1    ---->  0x11
  * 0   0   0    ---->  0x10
+ * 0x08 is added on top if an edge gets fewer raw hits than its
+ * minimum so far, which only classify_few_bits can tell.
 */
 inline u8 has_few_bits(afl_state_t *afl, u8* virgin_map) {
 
@@ -500,140 +583,285 @@ inline u8 has_few_bits(afl_state_t *afl, u8* virgin_map) {
   // we should run normal has_new_bits to wait for its arrival.
   if (unlikely(!afl->testcase_matrix)) { return has_new_bits(afl, virgin_map); }
 
-  u8 bms_decrease = 0; // whether bitmap_size gets decreased
-  u8 cov_decrease = 0; // whether at least one edge is no longer hit
-  u8 hcn_decrease = 0; // whether the total hit counts gets decreased
-  
-  u8 ret = 0x10; // ret < 0x10 means return as has_new_bits
-
-#ifdef WORD_SIZE_64
-
-  u64 *current = (u64 *)afl->fsrv.trace_bits;
-  u64 *virgin  = (u64 *)virgin_map;
-
-  u32 i = ((afl->fsrv.real_map_size + 7) >> 3);
-
-#else
-
-  u32 *current = (u32 *)afl->fsrv.trace_bits;
-  u32 *virgin  = (u32 *)virgin_map;
-
-  u32 i = ((afl->fsrv.real_map_size + 3) >> 2);
-
-#endif // WORD_SIZE_64
-
   //====== check bitmap_size ======//
   u32 cur_bitmap_size = count_bytes(afl, afl->fsrv.trace_bits);
-  if (cur_bitmap_size < afl->min_bitmap_size)
-    bms_decrease = 1;
 
   //====== check whether any edge no longer hit ======//
-  while (i--) {
-    // Now we need to deal with two damn cases:
-    // 1. (*virgin + 1) == 0
-    //    The edges is not touched by testcase matrix. Since coverage-decrease 
-    //    is going on, we only care about disappearance of already touched edges. 
-    //    So ignore this case to optimize.
-    // 2. (*current & *virgin) == 0
-    //    It's just like which in discover_word - i.e., no bits in current bitmap 
-    //    that have not been already cleared from the virgin map - this will almost 
-    //    always be the case. But when an edge is not touched anymore, bit-AND also
-    //    gives 0. We don't want to lose this since it's a typical coverage-decrease.
-    //    So we sacrifice the speed optimization in exchange for hope :-(
+  //====== check total hit counts ======//
+  // trace_bits has already been classfied. Total hit counts decrease only counts if
+  // there are some bits that have not been already cleared from the virgin map.
+  // Vectorized in skim_decrease, see decrease_word for what each word goes through.
+  // Only words still touched are worth a look, for virgin_bits we keep their index.
+  u8  hcn_check = afl->fsrv.actual_counts < afl->min_actual_cnts;
+  u8 *end = afl->fsrv.trace_bits + afl->fsrv.map_size;
+  u8  dec;
+
+  if (likely(virgin_map == afl->virgin_bits)) {
+
+    if (unlikely(afl->touched_words_stale)) { build_touched_words(afl); }
+
 #ifdef WORD_SIZE_64
-    if (unlikely((u64)(*virgin + 1)))
+    dec = skim_decrease_sparse((u64 *)virgin_map, (u64 *)afl->fsrv.trace_bits,
+            afl->touched_words, &afl->touched_words_cnt, hcn_check);
 #else
-    if (unlikely((u32)(*virgin + 1)))
-#endif
-    {
-      //====== check total hit counts ======//
-      if (unlikely((*current & *virgin) && (afl->fsrv.actual_counts < afl->min_actual_cnts)))
-        // trace_bits has already been classfied. We check if there are some bits 
-        // that have not been already cleared from the virgin map to reduce sensitivity.
-        hcn_decrease = 1;
+    dec = skim_decrease_sparse((u32 *)virgin_map, (u32 *)afl->fsrv.trace_bits,
+            afl->touched_words, &afl->touched_words_cnt, hcn_check);
+#endif // WORD_SIZE_64
 
-      u8* cur = (u8*)current;
-      u8* vir = (u8*)virgin;
+  } else {
 
 #ifdef WORD_SIZE_64
-      if ((vir[0] != 0xff && cur[0] == 0x0) || (vir[1] != 0xff && cur[1] == 0x0) ||
-          (vir[2] != 0xff && cur[2] == 0x0) || (vir[3] != 0xff && cur[3] == 0x0) ||
-          (vir[4] != 0xff && cur[4] == 0x0) || (vir[5] != 0xff && cur[5] == 0x0) ||
-          (vir[6] != 0xff && cur[6] == 0x0) || (vir[7] != 0xff && cur[7] == 0x0))
-      // If there is a touched byte being untouched now,
-      // it will mean there is a path disappeared. Update virgin_bits here!
-      {
-        if (vir[0] != 0xff && cur[0] == 0x0) { vir[0] = 0xff; }
-        if (vir[1] != 0xff && cur[1] == 0x0) { vir[1] = 0xff; }
-        if (vir[2] != 0xff && cur[2] == 0x0) { vir[2] = 0xff; }
-        if (vir[3] != 0xff && cur[3] == 0x0) { vir[3] = 0xff; }
-        if (vir[4] != 0xff && cur[4] == 0x0) { vir[4] = 0xff; }
-        if (vir[5] != 0xff && cur[5] == 0x0) { vir[5] = 0xff; }
-        if (vir[6] != 0xff && cur[6] == 0x0) { vir[6] = 0xff; }
-        if (vir[7] != 0xff && cur[7] == 0x0) { vir[7] = 0xff; }
-
-        cov_decrease = 1;
-      }
+    dec = skim_decrease((u64 *)virgin_map, (u64 *)afl->fsrv.trace_bits, (u64 *)end, hcn_check);
 #else
-      if ((vir[0] != 0xff && cur[0] == 0x0) || (vir[1] != 0xff && cur[1] == 0x0) ||
-          (vir[2] != 0xff && cur[2] == 0x0) || (vir[3] != 0xff && cur[3] == 0x0))
-      // If there is a touched byte being untouched now,
-      // it will mean there is a path disappeared. Update virgin_bits here!
-      {
-        if (vir[0] != 0xff && cur[0] == 0x0) { vir[0] = 0xff; }
-        if (vir[1] != 0xff && cur[1] == 0x0) { vir[1] = 0xff; }
-        if (vir[2] != 0xff && cur[2] == 0x0) { vir[2] = 0xff; }
-        if (vir[3] != 0xff && cur[3] == 0x0) { vir[3] = 0xff; }
-
-        cov_decrease = 1;
-      }
+    dec = skim_decrease((u32 *)virgin_map, (u32 *)afl->fsrv.trace_bits, (u32 *)end, hcn_check);
 #endif // WORD_SIZE_64
-    }
-    current++;
-    virgin++;
-  } // while (i--)
 
-  if (cov_decrease) afl->bitmap_changed = 1;
+  }
 
-  ret += bms_decrease<<2;
-  ret += cov_decrease<<1;
-  ret += hcn_decrease;
-  return ret; // should be in [0x10 , 0x17]
+  return few_bits_code(afl, cur_bitmap_size, dec);
 }
 
-#include "sym-blacklist.inc"
 /**
- * Read call stack file (if exists) generated
- * within __asan_on_error in the target, read
- * and check it to figure out the crash site.
- * This can help to check if interesting.
+ * Same as classify_counts followed by has_few_bits, but trace_bits
+ * only gets swept once - see classify_decrease. It is what the crash
+ * path of save_if_interesting runs on each crashing exec.
  * 
- * @attention The crash site should locate at
- * address (*offset) in virtual memory 
- * (before relocating if built as PIE, of course)
- * of the executable file located at path (*module),
- * However any of the three values could be 0,
- * due to those damn accidents behind.
- * So carefully check them before using!
+ * With IGORFUZZ_EDGEHITS, raw hit counts of each edge are
+ * also checked against min_edge_hits before classification.
  * 
- * @warning (*module) and (*symbol) will be
- * allocated by ck_strdup. Outside user 
- * should be responsible for calling ck_free
- * on them. WTF :-(
+ * @param cksum If not NULL, receive hash64 of the classified map.
+ * @return Same as has_few_bits.
+*/
+u8 classify_few_bits(afl_state_t *afl, u8 *virgin_map, u64 *cksum) {
+
+  if (unlikely(!afl->testcase_matrix)) {
+    classify_counts(&afl->fsrv);
+    if (cksum) { *cksum = hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST); }
+    return has_new_bits(afl, virgin_map);
+  }
+
+  void *hash_state = NULL;
+  if (cksum) {
+    if (unlikely(!afl->sweep_hash_state)) { afl->sweep_hash_state = hash64_stream_new(); }
+    hash_state = afl->sweep_hash_state;
+    hash64_stream_reset(hash_state);
+  }
+
+  u32 *idx = NULL;
+  u8  *min_hits = NULL;
+  if (likely(virgin_map == afl->virgin_bits)) {
+    if (unlikely(afl->touched_words_stale)) { build_touched_words(afl); }
+    idx = afl->touched_words;
+    min_hits = afl->min_edge_hits;
+  }
+
+  u32 cur_bitmap_size;
+  u8  dec = classify_decrease(&afl->fsrv, virgin_map, &cur_bitmap_size, hash_state,
+                              idx, &afl->touched_words_cnt, min_hits);
+
+  if (cksum) { *cksum = hash64_stream_digest(hash_state); }
+
+  // Fresh bits were looked for unconditionally
+  if (afl->fsrv.actual_counts >= afl->min_actual_cnts) { dec &= ~1; }
+
+  return few_bits_code(afl, cur_bitmap_size, dec);
+}
+
+/**
+ * Seed the per-edge minimum hit counts with the raw (not yet
+ * classified) trace_bits of the matrix. Called for each run of
+ * the matrix calibration. Edges the matrix doesn't touch stay 0,
+ * and skim_edge_hits never reports fewer hits for them.
+*/
+void seed_edge_hits(afl_state_t *afl) {
+
+  if (unlikely(!afl->min_edge_hits))
+    { afl->min_edge_hits = ck_alloc(afl->fsrv.map_size); }
+
+  u8 *raw = afl->fsrv.trace_bits, *mins = afl->min_edge_hits;
+  u32 i;
+
+  for (i = 0; i < afl->fsrv.map_size; ++i) {
+    if (raw[i] && (!mins[i] || raw[i] < mins[i])) { mins[i] = raw[i]; }
+  }
+}
+
+/**
+ * List the positions of the non-zero bytes of trace_bits in
+ * trace_nz, so walks over the trace of an exec cost as much as
+ * the trace is dense rather than as the map is large.
  * 
- * @param afl Need it to access call stack file.
- * @param flush If not 0, flush call stack file
- * with an empty line after everything done
- * (regardless of successful or failed parsing).
- * @param symbol Receive the symbol. Will be the
- * innermost one if inlined functions exist.
- * @param module Receive path to the module.
- * @param offset Receive offset in the module.
+ * @return Their count, same as count_bytes.
 */
-void __attribute__((hot))
-find_crash_site(afl_state_t *afl, u8 flush,
+u32 trace_nonzero(afl_state_t *afl) {
+
+  if (unlikely(!afl->trace_nz))
+    { afl->trace_nz = ck_alloc(afl->fsrv.map_size * sizeof(u32)); }
+
+  afl->trace_nz_cnt = skim_nonzero(afl->trace_nz, afl->fsrv.trace_bits,
+                                   afl->fsrv.trace_bits + afl->fsrv.map_size);
+  return afl->trace_nz_cnt;
+}
+
+/**
+ * The variance check of calibration: bytes of trace_bits differing
+ * from first_trace become variable and fully discovered in virgin_bits.
+*/
+void mark_var_bytes(afl_state_t *afl) {
+
+  u8 *end = afl->fsrv.trace_bits + afl->fsrv.map_size;
+
+  if (skim_var_bytes(afl->var_bytes, afl->virgin_bits, afl->first_trace,
+                     afl->fsrv.trace_bits, end))
+    { afl->touched_words_stale = 1; }
+}
+
+#include "sym-blacklist.inc"
+
+/**
+ * Ask the symbolizer about a stack frame which isn't
+ * in the symbol cache yet, and judge it by the function
+ * blacklist. The verdict goes into the symbol cache.
+*/
+static struct sym_cache_entry *
+symbolize_frame(afl_state_t *afl, u8 *path_, u32 addr_val) {
+
+  unsigned long n_sym = 0, li_, co_;
+  u8 *func = 0, *f_;  //so many damn stuffs!
+  u8  verdict = SYM_FRAME_UNKNOWN;
+
+  SanSymTool_addr_send(path_, addr_val, &n_sym);
+  SanSymTool_addr_read(0, (char**)(&f_), (char**)(&func), &li_, &co_);
+
+  if (n_sym) {
+    //If n_sym is non-zero, the module should be likely 
+    //an analyzable stuff where crash site may locate.
+    if (func) {
+      //If func isn't null, the symbolizer seems 
+      //worked and had told sth valid about the symbol.
+      //Next we are going to check the symbol.
+      verdict = SYM_FRAME_ALLOWED;
+      for (int i=0; sym_blacklist_function[i] != NULL; ++i) {
+        if (strstr(func, sym_blacklist_function[i]))
+          { verdict = SYM_FRAME_BLOCKED; break; }
+      }
+    } else {
+      verdict = SYM_FRAME_NOFUNC;
+    }
+  }
+
+  struct sym_cache_entry *sym = sym_cache_add(afl, path_, addr_val, verdict,
+    verdict == SYM_FRAME_ALLOWED ? func : NULL);
+  SanSymTool_addr_free();
+  return sym;
+}
+
+/**
+ * Feed one stack frame to the crash site search of find_crash_site.
+ * Frames must be fed from top (innermost) to bottom.
+ *
+ * @param path Path to the module of the frame.
+ * @param addr_val Offset in the module of the frame.
+*/
+static inline void
+check_crash_frame(afl_state_t *afl, u8 *path_, u32 addr_val,
   u8 **symbol, u8 **module, u32 *offset) {
-      *symbol = 0; *module = 0; *offset = 0; //safe init
+
+  //check if it is a blocked module
+  struct sym_module *mod = sym_module_get(afl, path_);
+  if (mod->blocked) {
+    //stack frame on a blocked module and the frames
+    //on the top of it all shouldn't be crash site.
+    //So drop anything found previously.
+    ck_free(*symbol); *symbol = 0; //ck_free allows NULL input
+    ck_free(*module); *module = 0; *offset = 0;
+    return; //go for next stack frame
+  }
+
+  //A frame in no function of the symtab goes to the symbolizer like
+  //without lazysym: it may know nothing of it and skip it.
+  if (afl->afl_env.igorfuzz_lazysym && mod->has_symtab &&
+      sym_module_func_addr(mod, addr_val)) {
+    //Judge the frame by raw address only. The symbol is
+    //left empty and resolved in write_crash_detail.
+    if (sym_module_blocked_addr(mod, addr_val)) {
+      ck_free(*symbol); *symbol = 0;
+      ck_free(*module); *module = 0; *offset = 0;
+    } else if (!(*module)) {
+      *symbol = 0;
+      *module = ck_strdup(path_); *offset = addr_val;
+    }
+    return;
+  }
+
+  //module isn't a blocked one, so we check symbol next
+  struct sym_cache_entry *sym = sym_cache_find(afl, path_, addr_val);
+  if (unlikely(!sym)) sym = symbolize_frame(afl, path_, addr_val);
+
+  switch (sym->verdict) {
+  case SYM_FRAME_BLOCKED:
+    //stack frames on and on the top of a blocked
+    //function all shouldn't be crash site.
+    //So drop anything found previously.
+    ck_free(*symbol); *symbol = 0;
+    ck_free(*module); *module = 0; *offset = 0;
+    break;
+  case SYM_FRAME_ALLOWED:
+    //set all three fields
+    if (!(*module)) {
+      *symbol = ck_strdup(sym->func);
+      *module = ck_strdup(path_); *offset = addr_val;
+    }
+    break;
+  case SYM_FRAME_NOFUNC:
+    //We still firmly believe that this is very likely
+    //the crash site, but it just can't be symbolized.
+    //So we only set module and offset.
+    if (!(*module)) {
+      *symbol = 0;
+      *module = ck_strdup(path_); *offset = addr_val;
+    }
+    break;
+  default: //SYM_FRAME_UNKNOWN
+    break;
+  }
+}
+
+/**
+ * Read raw stack frames written into the call stack
+ * channel (see callstack.h) within __asan_on_error.
+ * No syscall is involved here.
+*/
+static inline void
+find_crash_site_shm(afl_state_t *afl, struct igorfuzz_stack_map *map,
+  u8 flush, u8 **symbol, u8 **module, u32 *offset) {
+
+  u32 n_frames = map->n_frames;
+  if (unlikely(n_frames > IGORFUZZ_CALLSTACK_SHM_FRAMES))
+    n_frames = IGORFUZZ_CALLSTACK_SHM_FRAMES; //corrupted
+
+  for (u32 i = 0; i < n_frames; ++i) {
+    struct igorfuzz_frame *frame = &map->frames[i];
+    if (unlikely(frame->module_id >= map->n_modules ||
+                 frame->module_id >= IGORFUZZ_CALLSTACK_SHM_MODULES))
+      continue; //corrupted
+
+    check_crash_frame(afl, map->modules[frame->module_id], frame->offset,
+      symbol, module, offset);
+  }
+
+  if (flush) { map->n_frames = 0; }
+}
+
+/**
+ * Read call stack file (if exists) generated
+ * within __asan_on_error in the target.
+ * Only used if the target doesn't attach
+ * the call stack channel.
+*/
+static inline void
+find_crash_site_file(afl_state_t *afl,
+  u8 flush, u8 **symbol, u8 **module, u32 *offset) {
 
   if (unlikely(!afl->fsrv.call_stack_file)) { return; }
 
@@ -664,77 +892,8 @@ find_crash_site(afl_state_t *afl, u8 flush,
     *addr_str = '\0'; //all before belong to path
     addr_str += strlen(IGORFUZZ_CALLSTACK_FORMAT_ADDR);
 
-    //check if it is a blocked module
-    u8  module_blocked = 0;
-    u8 *module_name = strrchr(path_, '/');
-    if (unlikely(!module_name)) module_name = path_;
-    //stack frame on a blocked module and the frames
-    //on the top of it all shouldn't be crash site.
-#if IGORFUZZ_CALLSTACK_EXACT_MODULE
-    u8 *module_this = strrchr(afl->fsrv.target_path, '/');
-    if (unlikely(!module_this)) module_this = afl->fsrv.target_path;
-    if (unlikely(strcmp(module_this, module_name)))
-      module_blocked = 1;
-#else
-    for (int i=0; sym_blacklist_module[i] != NULL; ++i) {
-      if (strstr(module_name, sym_blacklist_module[i]))
-        { module_blocked = 1; break; }
-    }
-#endif
-    if (module_blocked) {
-      //drop anything found previously
-      ck_free(*symbol); *symbol = 0; //ck_free allows NULL input
-      ck_free(*module); *module = 0; *offset = 0; 
-      continue; //go for next stack frame
-    }
-    //module isn't a blocked one, so we check symbol next
     u32 addr_val = (u32)strtoul(addr_str, NULL, 16);
-
-    unsigned long n_sym = 0, li_, co_;
-    u8 *func = 0, *f_;  //so many damn stuffs!
-    //Symbolize it anyway. We'll check later.
-    SanSymTool_addr_send(path_, addr_val, &n_sym);
-    SanSymTool_addr_read(0, (char**)(&f_), (char**)(&func), &li_, &co_);
-
-    if (n_sym) {
-      //If n_sym is non-zero, the module should be likely 
-      //an analyzable stuff where crash site may locate.
-      //So we set the crash site if not found previously.
-      //If the symbol is proved to be blocked later, 
-      //we'll remove it.
-      if (func) {
-        //If func isn't null, the symbolizer seems 
-        //worked and had told sth valid about the symbol.
-        //Next we are going to check the symbol.
-        u8 func_blocked = 0;
-        for (int i=0; sym_blacklist_function[i] != NULL; ++i) {
-          if (strstr(func, sym_blacklist_function[i]))
-            //stack frames on and on the top of a blocked
-            //function all shouldn't be crash site.
-            { func_blocked = 1; break; }
-        }
-        if (func_blocked) {
-          //drop anything found previously
-          ck_free(*symbol); *symbol = 0;
-          ck_free(*module); *module = 0; *offset = 0;
-        } else {
-          //set all three fields
-          if (!(*module)) {
-            *symbol = ck_strdup(func);
-            *module = ck_strdup(path_); *offset = addr_val;
-          }
-        }
-      } else {
-        //If func is null, we still firmly believe that this is 
-        //very likely the crash site, but it just can't be symbolized.
-        //So we only set module and offset.
-        if (!(*module)) {
-          *symbol = 0;
-          *module = ck_strdup(path_); *offset = addr_val;
-        }
-      }
-    } // if (n_sym) END
-    SanSymTool_addr_free();
+    check_crash_frame(afl, path_, addr_val, symbol, module, offset);
   } // while (fgets(...)) END
 
   ck_free(line_buf);
@@ -743,40 +902,73 @@ find_crash_site(afl_state_t *afl, u8 flush,
 }
 
 /**
- * Write README.txt in the crash directory for queued entry `q`
+ * Read call stack data generated within
+ * __asan_on_error in the target, and check
+ * it to figure out the crash site.
+ * This can help to check if interesting.
+ * 
+ * Frames are taken from the call stack channel
+ * in shared memory if the target attached it,
+ * otherwise from the call stack file.
+ * 
+ * @attention The crash site should locate at
+ * address (*offset) in virtual memory 
+ * (before relocating if built as PIE, of course)
+ * of the executable file located at path (*module),
+ * However any of the three values could be 0,
+ * due to those damn accidents behind.
+ * So carefully check them before using!
+ * 
+ * @warning (*module) and (*symbol) will be
+ * allocated by ck_strdup. Outside user 
+ * should be responsible for calling ck_free
+ * on them. WTF :-(
+ * 
+ * @param afl Need it to access call stack data.
+ * @param flush If not 0, flush call stack data
+ * after everything done (regardless of successful
+ * or failed parsing).
+ * @param symbol Receive the symbol. Will be the
+ * innermost one if inlined functions exist.
+ * With IGORFUZZ_LAZYSYM it is usually left NULL
+ * and resolved by write_crash_detail on demand.
+ * @param module Receive path to the module.
+ * @param offset Receive offset in the module.
 */
 void __attribute__((hot))
-write_crash_detail(afl_state_t *afl, struct queue_entry *q) {
+find_crash_site(afl_state_t *afl, u8 flush,
+  u8 **symbol, u8 **module, u32 *offset) {
+      *symbol = 0; *module = 0; *offset = 0; //safe init
 
-  u8 fn[PATH_MAX];
-  sprintf(fn, "%s/crashes/README.txt", afl->out_dir);
+  struct igorfuzz_stack_map *map = afl->shm.stack_map;
 
-  FILE *f = fopen(fn, "a");
-  if (unlikely(!f)) { PFATAL("Failed to open %s", fn); }
+  if (likely(map && map->magic == IGORFUZZ_CALLSTACK_SHM_MAGIC))
+    find_crash_site_shm(afl, map, flush, symbol, module, offset);
+  else
+    find_crash_site_file(afl, flush, symbol, module, offset);
+}
 
-  fprintf(f, "@FILE:%s; @SIZE:%x; @HITS:%llx; ",
-    q->fname,
-    q->bitmap_size,
-    afl->fsrv.actual_counts
-  );
+/**
+ * Record the crash details of queued entry `q` in the
+ * crash detail log, see afl-fuzz-crashlog.c
+*/
+void __attribute__((hot))
+write_crash_detail(afl_state_t *afl, struct queue_entry *q) {
 
-  if (afl->crash_mode >= IGORFUZZ_NEW_CRASH_MODE_LV1) {
-    if (afl->fsrv.crash_module) {
-      fprintf(f, "@ADDR:%s+0x%x; ", afl->fsrv.crash_module, afl->fsrv.crash_offset);
-    } else {
-      fprintf(f, "@ADDR:%s; ", IGORFUZZ_CALLSTACK_NUL_TEXT);
-    }
-  }
   if (afl->crash_mode >= IGORFUZZ_NEW_CRASH_MODE_LV2) {
-    if (afl->fsrv.crash_symbol) {
-      fprintf(f, "@FUNC:%s; ", afl->fsrv.crash_symbol);
-    } else {
-      fprintf(f, "@FUNC:%s; ", IGORFUZZ_CALLSTACK_NUL_TEXT);
+    if (afl->afl_env.igorfuzz_lazysym &&
+        !afl->fsrv.crash_symbol && afl->fsrv.crash_module) {
+      //Only now do we need the name of the crash site
+      struct sym_cache_entry *sym = sym_cache_find(afl,
+        afl->fsrv.crash_module, afl->fsrv.crash_offset);
+      if (!sym) sym = symbolize_frame(afl,
+        afl->fsrv.crash_module, afl->fsrv.crash_offset);
+      if (sym->verdict == SYM_FRAME_ALLOWED)
+        afl->fsrv.crash_symbol = ck_strdup(sym->func);
     }
   }
 
-  fprintf(f, "\n");
-  fclose(f);
+  crash_log_add(afl, q);
 }
 
 /**
@@ -828,10 +1020,10 @@ same_crash_site(afl_state_t *afl, struct queue_entry *q, u8 detail, u8 discard)
         write_crash_detail(afl, q);
       }
       if (discard) {
-        q->disabled = 1;
+        QUEUE_HOT_SET(afl, q, disabled, 1);
         q->perf_score = 0;
         if (!q->was_fuzzed) {
-          q->was_fuzzed = 1;
+          QUEUE_HOT_SET(afl, q, was_fuzzed, 1);
           --afl->pending_not_fuzzed;
           --afl->active_items;
         }
@@ -849,6 +1041,38 @@ same_crash_site(afl_state_t *afl, struct queue_entry *q, u8 detail, u8 discard)
   return is_same;
 }
 
+/**
+ * Check if the exec just run crashed at the crash site kept in
+ * fsrv, like same_crash_site does, but leave the call stack data
+ * alone so save_if_interesting can still judge the exec after.
+ * 
+ * @return 1 for same, or if the crash site isn't kept at all
+ * (below IGORFUZZ_NEW_CRASH_MODE_LV3). 0 for different.
+*/
+u8 peek_crash_site(afl_state_t *afl) {
+
+  if (afl->crash_mode < IGORFUZZ_NEW_CRASH_MODE_LV3) { return 1; }
+
+  u8 *sym, *mod; u32 ofs;
+  find_crash_site(afl, 0, &sym, &mod, &ofs);
+
+  u8 is_same = ofs == afl->fsrv.crash_offset &&
+    (mod && afl->fsrv.crash_module ? !strcmp(mod, afl->fsrv.crash_module)
+                                   : !mod && !afl->fsrv.crash_module);
+
+  ck_free(sym);
+  ck_free(mod);
+  return is_same;
+}
+
+/* Saturated increment of path frequency for AFLFast-like schedules */
+static inline void count_path_freq(afl_state_t *afl, u64 cksum) {
+
+  if (likely(afl->n_fuzz[cksum % N_FUZZ_SIZE] < 0xFFFFFFFF))
+    afl->n_fuzz[cksum % N_FUZZ_SIZE]++;
+
+}
+
 /**
  * Check if the result of an execve() during routine fuzzing is interesting.
  * Save or queue the input test case for further analysis if so.
@@ -857,8 +1081,10 @@ same_crash_site(afl_state_t *afl, struct queue_entry *q, u8 detail, u8 discard)
  * 
  * @return Returns 1 if entry is saved, 0 otherwise.
 */
-u8 __attribute__((hot))
-save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
+static inline u8 __attribute__((hot))
+judge_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
+
+  afl->last_few_bits = 0; //what has_few_bits said of a crash or hang, if it got asked
 
   if (unlikely(len == 0)) { return 0; }
   if (unlikely(fault == FSRV_RUN_TMOUT && afl->afl_env.afl_ignore_timeouts)) { return 0; }
@@ -869,6 +1095,8 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
   u8  classified = 0; u64 cksum = 0; //help afl->schedule
   u8  is_timeout = 0, few_bits = 0; //state store before function return
   u8  res;
+  u8  cksum_done = 0; u64 exec_cksum = 0; //checksum of the classified map
+  u8  path_freq_due = 0; //crashes update path frequency in their own sweep
 
   /* Update path frequency. */
 
@@ -876,18 +1104,23 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
      only be used for special schedules */
   if (unlikely(afl->schedule >= FAST && afl->schedule <= RARE)) {
 
-    classify_counts(&afl->fsrv);
-    classified = 1;
+    if (likely(fault == FSRV_RUN_CRASH && afl->testcase_matrix)) {
 
-    cksum = hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST);
+      path_freq_due = 1;
 
-    /* Saturated increment */
-    if (likely(afl->n_fuzz[cksum % N_FUZZ_SIZE] < 0xFFFFFFFF))
-      afl->n_fuzz[cksum % N_FUZZ_SIZE]++;
+    } else {
+
+      classify_counts(&afl->fsrv);
+      classified = 1;
+
+      cksum = hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST);
+      count_path_freq(afl, cksum);
+
+    }
 
   }
 
-  while (1) { switch (fault) {
+  while (1) { afl->reduce_fb.fault = fault; switch (fault) {
     case FSRV_RUN_TMOUT:
     ////////////////////
       //Timeouts are not very interesting, but we're still obliged to keep
@@ -901,6 +1134,9 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
       simplify_trace(afl, afl->fsrv.trace_bits);
 
       few_bits = has_few_bits(afl, afl->virgin_tmout);
+      afl->last_few_bits = few_bits;
+      afl->reduce_fb.bitmap_size = afl->last_bitmap_size;
+      afl->reduce_fb.actual_counts = afl->fsrv.actual_counts;
       if (few_bits == 0x10 || few_bits == 0x00) { return 0; }
 
       //It's an interesting timeout. Go to save it.
@@ -948,8 +1184,14 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
       ++afl->total_crashes;
 
       if (unlikely(afl->crash_mode >= IGORFUZZ_NEW_CRASH_MODE_LV3)) {
-        if (unlikely(!same_crash_site(afl, NULL, 0, 0)))
+        afl->reduce_fb.same_site = same_crash_site(afl, NULL, 0, 0);
+        if (unlikely(!afl->reduce_fb.same_site)) {
+          if (unlikely(path_freq_due)) {
+            classify_counts(&afl->fsrv);
+            count_path_freq(afl, hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST));
+          }
           return 0; // Crash site changed. Discard this case.
+        }
       }
 
       if (likely(classified)) {
@@ -958,22 +1200,31 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
 
       } else {
 
-        classify_counts(&afl->fsrv);    classified = 1;
-        few_bits = has_few_bits(afl, afl->virgin_bits);
+        //One sweep for classification, decrease and checksum
+        few_bits = classify_few_bits(afl, afl->virgin_bits, &exec_cksum);
+        classified = 1; cksum_done = 1;
 
       }
 
+      if (unlikely(path_freq_due)) { cksum = exec_cksum; count_path_freq(afl, cksum); }
+
+      afl->last_few_bits = few_bits;
+      //calibrate_case runs has_few_bits again, keep those of this exec
+      afl->reduce_fb.bitmap_size = afl->last_bitmap_size;
+      afl->reduce_fb.actual_counts = afl->fsrv.actual_counts;
       if (likely(few_bits == 0x10 || few_bits == 0x00)) { return 0; }
 
-      queue_fn = alloc_printf("%s/queue/id:%06u,%s", afl->out_dir, afl->queued_items,
+      queue_fn = alloc_printf("%s/queue/id:%06u,%s", afl->out_dir,
+          afl->queued_items + afl->queued_collected,
           describe_op(afl, few_bits + is_timeout, NAME_MAX - strlen("id:000000,")));
 
-      fd = open(queue_fn, O_WRONLY | O_CREAT | O_EXCL, DEFAULT_PERMISSION);
-      if (unlikely(fd < 0)) { PFATAL("Unable to create '%s'", queue_fn); }
-      ck_write(fd, mem, len, queue_fn);
-      close(fd);
+      write_queue_file(afl, queue_fn, mem, len);
       //After this afl->queue_top will points to the entry just added
       add_to_queue(afl, queue_fn, len, 0);
+      if (likely(afl->queue_cur)) {
+        ++afl->queue_cur->decrease_finds;
+        ++afl->queue_cur->decrease_recent;
+      }
 
       if (few_bits & 0x02) {
         // this means +cov or -cov
@@ -982,12 +1233,14 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
       }
 
       // due to classify counts we have to recalculate the checksum
-      afl->queue_top->exec_cksum =
-          hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST);
+      if (unlikely(!cksum_done))
+        exec_cksum = hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST);
+      afl->queue_top->exec_cksum = exec_cksum;
 
       // For AFLFast schedules we update the new queue entry
       if (likely(cksum)) {
-        afl->queue_top->n_fuzz_entry = cksum % N_FUZZ_SIZE;
+        QUEUE_HOT_SET(afl, afl->queue_top, n_fuzz_entry,
+                      cksum % N_FUZZ_SIZE);
         afl->n_fuzz[afl->queue_top->n_fuzz_entry] = 1;
       }
 
@@ -1011,8 +1264,11 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
           //If arrive here, the crash site should keep same.
           //However we still do double check in case it changed
           //because the testcase has been calibrated before.
-          crash_detail_saved = 
-            same_crash_site(afl, afl->queue_top, 1, 0) ? 0 : 1;
+          //With IGORFUZZ_FASTCAL, a stable calibration keeps
+          //the site of the exec which found it.
+          if (!afl->afl_env.igorfuzz_fastcal || afl->queue_top->var_behavior)
+            crash_detail_saved = 
+              same_crash_site(afl, afl->queue_top, 1, 0) ? 0 : 1;
         }
         else if (likely(afl->crash_mode < IGORFUZZ_NEW_CRASH_MODE_LV3))
         {
@@ -1063,6 +1319,39 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
   return 0;
 }
 
+/**
+ * Same as judge_if_interesting, then tell custom mutators with an
+ * afl_custom_reduce_feedback what it decided - rejects included.
+*/
+u8 __attribute__((hot))
+save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
+
+  if (likely(!afl->custom_reduce_feedback))
+    { return judge_if_interesting(afl, mem, len, fault); }
+
+  struct reduce_feedback *fb = &afl->reduce_fb;
+  fb->fault = fault;
+  fb->same_site = 2;
+  fb->result = judge_if_interesting(afl, mem, len, fault);
+  fb->few_bits = afl->last_few_bits;
+  if (fb->few_bits < 0x10) { fb->bitmap_size = 0; fb->actual_counts = 0; }
+  fb->min_bitmap_size = afl->min_bitmap_size;
+  fb->min_actual_cnts = afl->min_actual_cnts;
+
+  // The site in fsrv is this exec's if it matched at LV3, or if a crash
+  // got queued below LV3. Otherwise it is left from an exec before.
+  u8 site_known = fb->fault == FSRV_RUN_CRASH && afl->crash_mode &&
+      (fb->same_site == 1 ||
+       (fb->result && afl->crash_mode < IGORFUZZ_NEW_CRASH_MODE_LV3));
+  fb->crash_module = site_known ? afl->fsrv.crash_module : NULL;
+  fb->crash_symbol = site_known ? afl->fsrv.crash_symbol : NULL;
+  fb->crash_offset = site_known ? afl->fsrv.crash_offset : 0;
+  fb->fname = fb->result && fb->fault == FSRV_RUN_CRASH ? afl->queue_top->fname
+                                                        : NULL;
+  run_afl_custom_reduce_feedback(afl);
+  return fb->result;
+}
+
 
 #else // IGORFUZZ_FEATURE_ENABLE
 
@@ -1200,7 +1489,7 @@ save_if_interesting(afl_state_t *afl, void *mem, u32 len, u8 fault) {
     /* For AFLFast schedules we update the new queue entry */
     if (likely(cksum)) {
 
-      afl->queue_top->n_fuzz_entry = cksum % N_FUZZ_SIZE;
+      QUEUE_HOT_SET(afl, afl->queue_top, n_fuzz_entry, cksum % N_FUZZ_SIZE);
       afl->n_fuzz[afl->queue_top->n_fuzz_entry] = 1;
 
     }
@@ -0,0 +1,159 @@
+/*
+   IgorFuzz - crash detail log
+   ---------------------------
+
+   Each saved entry comes with a record of its crash details. Records
+   are rendered into memory and written out in one go from time to
+   time, so the save path itself never touches the filesystem for them.
+
+   crashes/crash_detail.jsonl gets one JSON object per entry:
+
+     {"file":..., "size":..., "hits":..., "module":..., "offset":...,
+      "symbol":..., "execs":..., "time":...}
+
+   where module and offset come with -C, symbol with -CC, and time is
+   in milliseconds since the start of fuzzing. With IGORFUZZ_CRASHTXT,
+   crashes/README.txt keeps getting the old "@FILE:...; @SIZE:...;"
+   lines too, for tools still parsing them.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include "afl-fuzz.h"
+
+#if IGORFUZZ_FEATURE_ENABLE
+
+#include <stdarg.h>
+
+static void crash_log_open(afl_state_t *afl, struct crash_log_buf *b, u8 *name) {
+  b->fn = alloc_printf("%s/crashes/%s", afl->root_out_dir, name);
+  b->fd = open(b->fn, O_WRONLY | O_CREAT | O_APPEND, DEFAULT_PERMISSION);
+  if (b->fd < 0) { PFATAL("Unable to open '%s'", b->fn); }
+}
+
+static void crash_log_write(struct crash_log_buf *b) {
+  if (!b->len || b->fd < 0) { return; }
+  ck_write(b->fd, b->data, b->len, b->fn);
+  b->len = 0;
+}
+
+static void crash_log_printf(struct crash_log_buf *b, const char *fmt, ...) {
+  va_list ap;
+  s32 n;
+
+  while (1) {
+    va_start(ap, fmt);
+    n = vsnprintf(b->data + b->len, b->size - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) { FATAL("vsnprintf() failed"); }
+    if (b->len + n < b->size) { break; }
+    b->size = MAX(b->size * 2, b->len + n + 1);
+    b->data = ck_realloc(b->data, b->size);
+  }
+
+  b->len += n;
+}
+
+/* JSON string, or null. Paths and symbols rarely need escaping. */
+static void crash_log_json_str(struct crash_log_buf *b, u8 *str) {
+  if (!str) { crash_log_printf(b, "null"); return; }
+
+  crash_log_printf(b, "\"");
+  for (; *str; ++str) {
+    if (*str == '"' || *str == '\\') {
+      crash_log_printf(b, "\\%c", *str);
+    } else if (*str < 0x20) {
+      crash_log_printf(b, "\\u%04x", *str);
+    } else {
+      crash_log_printf(b, "%c", *str);
+    }
+  }
+  crash_log_printf(b, "\"");
+}
+
+/**
+ * Open the log files under the crash directory.
+ * Records of a resumed run are appended.
+*/
+void crash_log_init(afl_state_t *afl) {
+  crash_log_open(afl, &afl->crash_log_jsonl, IGORFUZZ_CRASH_LOG_JSONL);
+  if (afl->afl_env.igorfuzz_crashtxt)
+    crash_log_open(afl, &afl->crash_log_text, IGORFUZZ_CRASH_LOG_TEXT);
+}
+
+/**
+ * Record the crash details of queued entry `q`, taken from the
+ * crash site in afl->fsrv and the latest exec of `q`.
+*/
+void crash_log_add(afl_state_t *afl, struct queue_entry *q) {
+  struct crash_log_buf *b = &afl->crash_log_jsonl;
+
+  u8 *module = 0, *symbol = 0;
+  u8  has_site = afl->crash_mode >= IGORFUZZ_NEW_CRASH_MODE_LV1;
+  u8  has_func = afl->crash_mode >= IGORFUZZ_NEW_CRASH_MODE_LV2;
+  if (has_site) { module = afl->fsrv.crash_module; }
+  if (has_func) { symbol = afl->fsrv.crash_symbol; }
+
+  crash_log_printf(b, "{\"file\":");
+  crash_log_json_str(b, q->fname);
+  crash_log_printf(b, ",\"size\":%u,\"hits\":%llu,\"module\":",
+    q->bitmap_size, afl->fsrv.actual_counts);
+  crash_log_json_str(b, module);
+  if (module) {
+    crash_log_printf(b, ",\"offset\":%u,\"symbol\":", afl->fsrv.crash_offset);
+  } else {
+    crash_log_printf(b, ",\"offset\":null,\"symbol\":");
+  }
+  crash_log_json_str(b, symbol);
+  crash_log_printf(b, ",\"execs\":%llu,\"time\":%llu}\n",
+    afl->fsrv.total_execs,
+    get_cur_time() + afl->prev_run_time - afl->start_time);
+
+  if (b->len >= IGORFUZZ_CRASH_LOG_BUFFER) { crash_log_write(b); }
+
+  if (afl->crash_log_text.fd < 0) { return; }
+  b = &afl->crash_log_text;
+
+  crash_log_printf(b, "@FILE:%s; @SIZE:%x; @HITS:%llx; ",
+    q->fname, q->bitmap_size, afl->fsrv.actual_counts);
+  if (has_site) {
+    if (module) {
+      crash_log_printf(b, "@ADDR:%s+0x%x; ", module, afl->fsrv.crash_offset);
+    } else {
+      crash_log_printf(b, "@ADDR:%s; ", IGORFUZZ_CALLSTACK_NUL_TEXT);
+    }
+  }
+  if (has_func) {
+    crash_log_printf(b, "@FUNC:%s; ", symbol ? symbol : (u8 *)IGORFUZZ_CALLSTACK_NUL_TEXT);
+  }
+  crash_log_printf(b, "\n");
+
+  if (b->len >= IGORFUZZ_CRASH_LOG_BUFFER) { crash_log_write(b); }
+}
+
+/* Write out what is buffered. */
+void crash_log_flush(afl_state_t *afl) {
+  crash_log_write(&afl->crash_log_jsonl);
+  crash_log_write(&afl->crash_log_text);
+}
+
+void crash_log_close(afl_state_t *afl) {
+  struct crash_log_buf *logs[] = { &afl->crash_log_jsonl, &afl->crash_log_text };
+
+  for (u32 i = 0; i < sizeof(logs) / sizeof(logs[0]); ++i) {
+    crash_log_write(logs[i]);
+    if (logs[i]->fd >= 0) { close(logs[i]->fd); }
+    logs[i]->fd = -1;
+    ck_free(logs[i]->data);
+    ck_free(logs[i]->fn);
+    logs[i]->data = logs[i]->fn = NULL;
+    logs[i]->len = logs[i]->size = 0;
+  }
+}
+
+#endif // IGORFUZZ_FEATURE_ENABLE
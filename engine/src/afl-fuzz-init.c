@@ -1022,12 +1022,12 @@ void perform_dry_run(afl_state_t *afl) {
           WARNF("Test case results in a timeout (skipping)");
           ++cal_failures;
           q->cal_failed = CAL_CHANCES;
-          q->disabled = 1;
+          QUEUE_HOT_SET(afl, q, disabled, 1);
           q->perf_score = 0;
 
           if (!q->was_fuzzed) {
 
-            q->was_fuzzed = 1;
+            QUEUE_HOT_SET(afl, q, was_fuzzed, 1);
             --afl->pending_not_fuzzed;
             --afl->active_items;
 
@@ -1162,13 +1162,13 @@ void perform_dry_run(afl_state_t *afl) {
 
         if (!q->was_fuzzed) {
 
-          q->was_fuzzed = 1;
+          QUEUE_HOT_SET(afl, q, was_fuzzed, 1);
           --afl->pending_not_fuzzed;
           --afl->active_items;
 
         }
 
-        q->disabled = 1;
+        QUEUE_HOT_SET(afl, q, disabled, 1);
         q->perf_score = 0;
 
         u32 i = 0;
@@ -1310,26 +1310,26 @@ void perform_dry_run(afl_state_t *afl) {
 
           if (!p->was_fuzzed) {
 
-            p->was_fuzzed = 1;
+            QUEUE_HOT_SET(afl, p, was_fuzzed, 1);
             --afl->pending_not_fuzzed;
             --afl->active_items;
 
           }
 
-          p->disabled = 1;
+          QUEUE_HOT_SET(afl, p, disabled, 1);
           p->perf_score = 0;
 
         } else {
 
           if (!q->was_fuzzed) {
 
-            q->was_fuzzed = 1;
+            QUEUE_HOT_SET(afl, q, was_fuzzed, 1);
             --afl->pending_not_fuzzed;
             --afl->active_items;
 
           }
 
-          q->disabled = 1;
+          QUEUE_HOT_SET(afl, q, disabled, 1);
           q->perf_score = 0;
 
           done = 1;
@@ -1715,6 +1715,12 @@ void nuke_resume_dir(afl_state_t *afl) {
   if (delete_files(fn, CASE_PREFIX)) { goto dir_cleanup_failed; }
   ck_free(fn);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  fn = alloc_printf("%s/_resume/.state/dominated", afl->out_dir);
+  if (delete_files(fn, CASE_PREFIX)) { goto dir_cleanup_failed; }
+  ck_free(fn);
+#endif
+
   fn = alloc_printf("%s/_resume/.state", afl->out_dir);
   if (rmdir(fn) && errno != ENOENT) { goto dir_cleanup_failed; }
   ck_free(fn);
@@ -1834,6 +1840,11 @@ static void handle_existing_out_dir(afl_state_t *afl) {
 
     rename(orig_q, afl->in_dir);                           /* Ignore errors */
 
+#if IGORFUZZ_FEATURE_ENABLE
+    // Entries still only in the queue store of the last run
+    queue_store_recover(afl, afl->in_dir);
+#endif
+
     OKF("Output directory exists, will attempt session resume.");
 
     ck_free(orig_q);
@@ -1875,6 +1886,12 @@ static void handle_existing_out_dir(afl_state_t *afl) {
   if (delete_files(fn, CASE_PREFIX)) { goto dir_cleanup_failed; }
   ck_free(fn);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  fn = alloc_printf("%s/queue/.state/dominated", afl->out_dir);
+  if (delete_files(fn, CASE_PREFIX)) { goto dir_cleanup_failed; }
+  ck_free(fn);
+#endif
+
   /* Then, get rid of the .state subdirectory itself (should be empty by now)
      and everything matching <afl->out_dir>/queue/id:*. */
 
@@ -2019,6 +2036,20 @@ static void handle_existing_out_dir(afl_state_t *afl) {
   if (unlink(fn) && errno != ENOENT) { goto dir_cleanup_failed; }
   ck_free(fn);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  /* A resumed run has its own queue store, the one of the last run
+     went to _resume/ above. */
+
+  fn = alloc_printf("%s/" IGORFUZZ_STORE_DATA, afl->out_dir);
+  if (unlink(fn) && errno != ENOENT) { goto dir_cleanup_failed; }
+  ck_free(fn);
+
+  fn = alloc_printf("%s/" IGORFUZZ_STORE_INDEX, afl->out_dir);
+  if (unlink(fn) && errno != ENOENT) { goto dir_cleanup_failed; }
+  ck_free(fn);
+
+#endif
+
   fn = alloc_printf("%s/cmdline", afl->out_dir);
   if (unlink(fn) && errno != ENOENT) { goto dir_cleanup_failed; }
   ck_free(fn);
@@ -2172,6 +2203,14 @@ void setup_dirs_fds(afl_state_t *afl) {
   if (mkdir(tmp, 0700)) { PFATAL("Unable to create '%s'", tmp); }
   ck_free(tmp);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  /* Entries off the Pareto frontier, with IGORFUZZ_PARETO_MOVE. */
+
+  tmp = alloc_printf("%s/queue/.state/dominated/", afl->out_dir);
+  if (mkdir(tmp, 0700)) { PFATAL("Unable to create '%s'", tmp); }
+  ck_free(tmp);
+#endif
+
   /* Sync directory for keeping track of cooperating fuzzers. */
 
   if (afl->sync_id) {
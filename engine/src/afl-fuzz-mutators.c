@@ -70,6 +70,23 @@ void run_afl_custom_queue_new_entry(afl_state_t *afl, struct queue_entry *q,
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+void run_afl_custom_reduce_feedback(afl_state_t *afl) {
+
+  LIST_FOREACH(&afl->custom_mutator_list, struct custom_mutator, {
+
+    if (el->afl_custom_reduce_feedback) {
+
+      el->afl_custom_reduce_feedback(el->data, &afl->reduce_fb);
+
+    }
+
+  });
+
+}
+
+#endif
+
 void setup_custom_mutators(afl_state_t *afl) {
 
   /* Try mutator library first */
@@ -409,6 +426,23 @@ struct custom_mutator *load_custom_mutator(afl_state_t *afl, const char *fn) {
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  /* "afl_custom_reduce_feedback", optional */
+  mutator->afl_custom_reduce_feedback =
+      dlsym(dh, "afl_custom_reduce_feedback");
+  if (!mutator->afl_custom_reduce_feedback) {
+
+    ACTF("optional symbol 'afl_custom_reduce_feedback' not found.");
+
+  } else {
+
+    OKF("Found 'afl_custom_reduce_feedback'.");
+    afl->custom_reduce_feedback = 1;
+
+  }
+
+#endif
+
   /* "afl_custom_describe", optional */
   mutator->afl_custom_describe = dlsym(dh, "afl_custom_describe");
   if (!mutator->afl_custom_describe) {
@@ -607,6 +641,9 @@ u8 trim_case_custom(afl_state_t *afl, struct queue_entry *q, u8 *in_buf,
 
   if (out_buf) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+    rewrite_queue_file(afl, q, out_buf, out_len);
+#else
     s32 fd;
 
     unlink(q->fname);                                      /* ignore errors */
@@ -617,6 +654,7 @@ u8 trim_case_custom(afl_state_t *afl, struct queue_entry *q, u8 *in_buf,
 
     ck_write(fd, out_buf, out_len, q->fname);
     close(fd);
+#endif
 
     /* Update the queue's knowledge of length as soon as we write the file.
        We do this here so that exit/error cases that *don't* update the file
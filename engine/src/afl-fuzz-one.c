@@ -363,6 +363,104 @@ static void locate_diffs(u8 *ptr1, u8 *ptr2, u32 len, s32 *first, s32 *last) {
 
 #endif                                                     /* !IGNORE_FINDS */
 
+#if IGORFUZZ_FEATURE_ENABLE
+
+/* End a fuzz_one round of q: its recent decrease finds and rounds both
+   decay, so -p decrease weighs it by what the last rounds yielded. */
+
+static inline void decrease_round(struct queue_entry *q) {
+
+  q->decrease_recent *= IGORFUZZ_DECREASE_DECAY;
+  q->decrease_rounds = (q->decrease_rounds + 1) * IGORFUZZ_DECREASE_DECAY;
+
+}
+
+/* A position in [from, to) to mutate at. If queue_cur has an influence
+   map, IGORFUZZ_INFLUENCE_BIAS percent of them fall into a block drawn
+   by the matrix edges it removed, as far as [from, to) has any. */
+
+static inline u32 influence_pos(afl_state_t *afl, u32 from, u32 to) {
+
+  struct influence_map *m = afl->queue_cur->influence;
+
+  if (likely(!m) || (from >> m->block_pow2) >= m->blocks ||
+      rand_below(afl, 100) >= IGORFUZZ_INFLUENCE_BIAS) {
+
+    return from + rand_below(afl, to - from);
+
+  }
+
+  u32 p = m->block_pow2;
+  u32 lo = from >> p, hi = MIN((to - 1) >> p, m->blocks - 1);
+  u32 base = lo ? m->cdf[lo - 1] : 0;
+
+  if (m->cdf[hi] == base) { return from + rand_below(afl, to - from); }
+
+  // First block in [lo, hi] whose prefix sum passes the draw
+  u32 r = base + rand_below(afl, m->cdf[hi] - base);
+  while (lo < hi) {
+
+    u32 mid = (lo + hi) >> 1;
+    if (m->cdf[mid] > r) { hi = mid; } else { lo = mid + 1; }
+
+  }
+
+  u32 start = MAX(lo << p, from), end = MIN((lo + 1) << p, to);
+  return start + rand_below(afl, end - start);
+
+}
+
+/* The havoc cases each operator of havoc_reduce stands for, both ends
+   included. RHAVOC_EXTRAS goes up to r_max, operators only in the
+   profile have cases of their own. */
+
+#define RHAVOC_CASE(_op) (0x10000 + (_op))
+
+static const u32 rhavoc_cases[RHAVOC_NUM][2] = {
+
+    [RHAVOC_DELETE] = {57, 64},
+    [RHAVOC_ZERO] = {RHAVOC_CASE(RHAVOC_ZERO), RHAVOC_CASE(RHAVOC_ZERO)},
+    [RHAVOC_TRUNCATE] = {RHAVOC_CASE(RHAVOC_TRUNCATE),
+                         RHAVOC_CASE(RHAVOC_TRUNCATE)},
+    [RHAVOC_MINIMAL] = {RHAVOC_CASE(RHAVOC_MINIMAL),
+                        RHAVOC_CASE(RHAVOC_MINIMAL)},
+    [RHAVOC_STRIP] = {RHAVOC_CASE(RHAVOC_STRIP), RHAVOC_CASE(RHAVOC_STRIP)},
+    [RHAVOC_OVERWRITE] = {48, 51},
+    [RHAVOC_FLIP] = {0, 3},
+    [RHAVOC_ARITH] = {16, 39},
+    [RHAVOC_INTEREST] = {4, 15},
+    [RHAVOC_RANDOM] = {40, 43},
+    [RHAVOC_BYTE] = {52, 54},
+    [RHAVOC_SWITCH] = {55, 56},
+    [RHAVOC_CLONE] = {44, 47},
+    [RHAVOC_EXTRAS] = {65, 65}
+
+};
+
+/* Draw the havoc case of the next mutation from the mix of
+   havoc_reduce, and note its operator for havoc_reduce_account. */
+
+static inline u32 havoc_reduce_pick(afl_state_t *afl, u32 r_max) {
+
+  struct havoc_reduce *h = afl->havoc_reduce;
+  double sel = rand_below(afl, 10000) * 0.0001;
+  u32    op = 0, hi;
+
+  while (op < RHAVOC_NUM - 1 && sel >= h->cdf[op]) { ++op; }
+  if (op == RHAVOC_EXTRAS && r_max <= rhavoc_cases[RHAVOC_EXTRAS][0]) {
+
+    op = RHAVOC_DELETE;
+
+  }
+
+  h->used[op] = 1;
+  hi = op == RHAVOC_EXTRAS ? r_max - 1 : rhavoc_cases[op][1];
+  return rhavoc_cases[op][0] + rand_below(afl, hi - rhavoc_cases[op][0] + 1);
+
+}
+
+#endif
+
 /* Take the current entry from the queue, fuzz it for a while. This
    function is a tad too long... returns 0 if fuzzed successfully, 1 if
    skipped or bailed out. */
@@ -558,6 +656,32 @@ u8 fuzz_one_original(afl_state_t *afl) {
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+
+  /*********
+   * DDMIN *
+   *********/
+
+  if (unlikely(afl->afl_env.igorfuzz_ddmin && afl->testcase_matrix &&
+               !afl->queue_cur->ddmin_done)) {
+
+    if (ddmin_stage(afl, in_buf, len)) { goto abandon_entry; }
+
+  }
+
+  /*************
+   * INFLUENCE *
+   *************/
+
+  if (unlikely(afl->afl_env.igorfuzz_influence && afl->matrix_edges &&
+               !afl->queue_cur->influence)) {
+
+    if (influence_stage(afl, out_buf, len)) { goto abandon_entry; }
+
+  }
+
+#endif
+
   if (unlikely(afl->shm.cmplog_mode &&
                afl->queue_cur->colorized < afl->cmplog_lvl &&
                (u32)len <= afl->cmplog_max_filesize)) {
@@ -2125,8 +2249,16 @@ havoc_stage:
 
 #define MAX_HAVOC_ENTRY 64
 #define MUTATE_ASCII_DICT 64
+#if IGORFUZZ_FEATURE_ENABLE
+  #define HAVOC_POS(_l) influence_pos(afl, 0, (_l))
+#else
+  #define HAVOC_POS(_l) rand_below(afl, (_l))
+#endif
 
   u32 r_max, r;
+#if IGORFUZZ_FEATURE_ENABLE
+  u8 reduce_mix = afl->havoc_reduce && afl->testcase_matrix;
+#endif
 
   r_max = (MAX_HAVOC_ENTRY + 1) + (afl->extras_cnt ? 4 : 0) +
           (afl->a_extras_cnt
@@ -2201,7 +2333,13 @@ havoc_stage:
 
       }
 
+#if IGORFUZZ_FEATURE_ENABLE
+      r = unlikely(reduce_mix) ? havoc_reduce_pick(afl, r_max)
+                               : rand_below(afl, r_max);
+      switch (r) {
+#else
       switch ((r = rand_below(afl, r_max))) {
+#endif
 
         case 0 ... 3: {
 
@@ -2210,6 +2348,13 @@ havoc_stage:
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " FLIP_BIT1");
           strcat(afl->mutation, afl->m_tmp);
+#endif
+#if IGORFUZZ_FEATURE_ENABLE
+          // One draw as upstream, unless there is an influence map
+          if (unlikely(afl->queue_cur->influence)) {
+            FLIP_BIT(out_buf, (HAVOC_POS(temp_len) << 3) + rand_below(afl, 8));
+            break;
+          }
 #endif
           FLIP_BIT(out_buf, rand_below(afl, temp_len << 3));
           break;
@@ -2224,7 +2369,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING8");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)] =
+          out_buf[HAVOC_POS(temp_len)] =
               interesting_8[rand_below(afl, sizeof(interesting_8))];
           break;
 
@@ -2240,7 +2385,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING16");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          *(u16 *)(out_buf + rand_below(afl, temp_len - 1)) =
+          *(u16 *)(out_buf + HAVOC_POS(temp_len - 1)) =
               interesting_16[rand_below(afl, sizeof(interesting_16) >> 1)];
 
           break;
@@ -2257,7 +2402,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING16BE");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          *(u16 *)(out_buf + rand_below(afl, temp_len - 1)) = SWAP16(
+          *(u16 *)(out_buf + HAVOC_POS(temp_len - 1)) = SWAP16(
               interesting_16[rand_below(afl, sizeof(interesting_16) >> 1)]);
 
           break;
@@ -2274,7 +2419,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING32");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          *(u32 *)(out_buf + rand_below(afl, temp_len - 3)) =
+          *(u32 *)(out_buf + HAVOC_POS(temp_len - 3)) =
               interesting_32[rand_below(afl, sizeof(interesting_32) >> 2)];
 
           break;
@@ -2291,7 +2436,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING32BE");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          *(u32 *)(out_buf + rand_below(afl, temp_len - 3)) = SWAP32(
+          *(u32 *)(out_buf + HAVOC_POS(temp_len - 3)) = SWAP32(
               interesting_32[rand_below(afl, sizeof(interesting_32) >> 2)]);
 
           break;
@@ -2306,7 +2451,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH8_");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)] -= 1 + rand_below(afl, ARITH_MAX);
+          out_buf[HAVOC_POS(temp_len)] -= 1 + rand_below(afl, ARITH_MAX);
           break;
 
         }
@@ -2319,7 +2464,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH8+");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)] += 1 + rand_below(afl, ARITH_MAX);
+          out_buf[HAVOC_POS(temp_len)] += 1 + rand_below(afl, ARITH_MAX);
           break;
 
         }
@@ -2330,7 +2475,7 @@ havoc_stage:
 
           if (temp_len < 2) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 1);
+          u32 pos = HAVOC_POS(temp_len - 1);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16_-%u", pos);
@@ -2348,7 +2493,7 @@ havoc_stage:
 
           if (temp_len < 2) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 1);
+          u32 pos = HAVOC_POS(temp_len - 1);
           u16 num = 1 + rand_below(afl, ARITH_MAX);
 
 #ifdef INTROSPECTION
@@ -2369,7 +2514,7 @@ havoc_stage:
 
           if (temp_len < 2) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 1);
+          u32 pos = HAVOC_POS(temp_len - 1);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16+-%u", pos);
@@ -2387,7 +2532,7 @@ havoc_stage:
 
           if (temp_len < 2) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 1);
+          u32 pos = HAVOC_POS(temp_len - 1);
           u16 num = 1 + rand_below(afl, ARITH_MAX);
 
 #ifdef INTROSPECTION
@@ -2408,7 +2553,7 @@ havoc_stage:
 
           if (temp_len < 4) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 3);
+          u32 pos = HAVOC_POS(temp_len - 3);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32_-%u", pos);
@@ -2426,7 +2571,7 @@ havoc_stage:
 
           if (temp_len < 4) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 3);
+          u32 pos = HAVOC_POS(temp_len - 3);
           u32 num = 1 + rand_below(afl, ARITH_MAX);
 
 #ifdef INTROSPECTION
@@ -2447,7 +2592,7 @@ havoc_stage:
 
           if (temp_len < 4) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 3);
+          u32 pos = HAVOC_POS(temp_len - 3);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32+-%u", pos);
@@ -2465,7 +2610,7 @@ havoc_stage:
 
           if (temp_len < 4) { break; }
 
-          u32 pos = rand_below(afl, temp_len - 3);
+          u32 pos = HAVOC_POS(temp_len - 3);
           u32 num = 1 + rand_below(afl, ARITH_MAX);
 
 #ifdef INTROSPECTION
@@ -2490,7 +2635,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " RAND8");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)] ^= 1 + rand_below(afl, 255);
+          out_buf[HAVOC_POS(temp_len)] ^= 1 + rand_below(afl, 255);
           break;
 
         }
@@ -2503,7 +2648,7 @@ havoc_stage:
 
             u32 clone_len = choose_block_len(afl, temp_len);
             u32 clone_from = rand_below(afl, temp_len - clone_len + 1);
-            u32 clone_to = rand_below(afl, temp_len);
+            u32 clone_to = HAVOC_POS(temp_len);
 
 #ifdef INTROSPECTION
             snprintf(afl->m_tmp, sizeof(afl->m_tmp), " CLONE-%s-%u-%u-%u",
@@ -2543,7 +2688,7 @@ havoc_stage:
             /* Insert a block of constant bytes (25%). */
 
             u32 clone_len = choose_block_len(afl, HAVOC_BLK_XL);
-            u32 clone_to = rand_below(afl, temp_len);
+            u32 clone_to = HAVOC_POS(temp_len);
 
 #ifdef INTROSPECTION
             snprintf(afl->m_tmp, sizeof(afl->m_tmp), " CLONE-%s-%u-%u",
@@ -2587,7 +2732,7 @@ havoc_stage:
 
           u32 copy_len = choose_block_len(afl, temp_len - 1);
           u32 copy_from = rand_below(afl, temp_len - copy_len + 1);
-          u32 copy_to = rand_below(afl, temp_len - copy_len + 1);
+          u32 copy_to = HAVOC_POS(temp_len - copy_len + 1);
 
           if (likely(copy_from != copy_to)) {
 
@@ -2611,7 +2756,7 @@ havoc_stage:
           if (temp_len < 2) { break; }
 
           u32 copy_len = choose_block_len(afl, temp_len - 1);
-          u32 copy_to = rand_below(afl, temp_len - copy_len + 1);
+          u32 copy_to = HAVOC_POS(temp_len - copy_len + 1);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " OVERWRITE_FIXED-%u-%u",
@@ -2635,7 +2780,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ADDBYTE_");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)]++;
+          out_buf[HAVOC_POS(temp_len)]++;
           break;
 
         }
@@ -2648,7 +2793,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " SUBBYTE_");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)]--;
+          out_buf[HAVOC_POS(temp_len)]--;
           break;
 
         }
@@ -2661,7 +2806,7 @@ havoc_stage:
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " FLIP8_");
           strcat(afl->mutation, afl->m_tmp);
 #endif
-          out_buf[rand_below(afl, temp_len)] ^= 0xff;
+          out_buf[HAVOC_POS(temp_len)] ^= 0xff;
           break;
 
         }
@@ -2673,10 +2818,10 @@ havoc_stage:
           /* Switch bytes. */
 
           u32 to_end, switch_to, switch_len, switch_from;
-          switch_from = rand_below(afl, temp_len);
+          switch_from = HAVOC_POS(temp_len);
           do {
 
-            switch_to = rand_below(afl, temp_len);
+            switch_to = HAVOC_POS(temp_len);
 
           } while (switch_from == switch_to);
 
@@ -2728,7 +2873,7 @@ havoc_stage:
           /* Don't delete too much. */
 
           u32 del_len = choose_block_len(afl, temp_len - 1);
-          u32 del_from = rand_below(afl, temp_len - del_len + 1);
+          u32 del_from = HAVOC_POS(temp_len - del_len + 1);
 
 #ifdef INTROSPECTION
           snprintf(afl->m_tmp, sizeof(afl->m_tmp), " DEL-%u-%u", del_from,
@@ -2744,6 +2889,110 @@ havoc_stage:
 
         }
 
+#if IGORFUZZ_FEATURE_ENABLE
+        case RHAVOC_CASE(RHAVOC_ZERO): {
+
+          /* Zero bytes. */
+
+          u32 zero_len = choose_block_len(afl, temp_len);
+          u32 zero_from = HAVOC_POS(temp_len - zero_len + 1);
+
+          memset(out_buf + zero_from, 0, zero_len);
+          break;
+
+        }
+
+        case RHAVOC_CASE(RHAVOC_TRUNCATE): {
+
+          /* Cut bytes off the end. */
+
+          if (temp_len < 2) { break; }
+
+          temp_len -= choose_block_len(afl, temp_len - 1);
+          break;
+
+        }
+
+        case RHAVOC_CASE(RHAVOC_MINIMAL): {
+
+          /* Set a byte, word or dword to 0, 1 or half of it, either
+             endian - the least interesting values a length or a count
+             can take. */
+
+          u32 size = 1 << rand_below(afl, temp_len < 2   ? 1
+                                          : temp_len < 4 ? 2
+                                                         : 3);
+          u32 pos = HAVOC_POS(temp_len - size + 1);
+          u8  be = size > 1 && rand_below(afl, 2);
+          u32 val = 0, k;
+
+          for (k = 0; k < size; ++k) {
+
+            val |= (u32)out_buf[pos + (be ? size - 1 - k : k)] << (k << 3);
+
+          }
+
+          switch (rand_below(afl, 3)) {
+
+            case 0:
+              val = 0;
+              break;
+            case 1:
+              val = 1;
+              break;
+            default:
+              val >>= 1;
+              break;
+
+          }
+
+          for (k = 0; k < size; ++k) {
+
+            out_buf[pos + (be ? size - 1 - k : k)] = val >> (k << 3);
+
+          }
+
+          break;
+
+        }
+
+        case RHAVOC_CASE(RHAVOC_STRIP): {
+
+          /* Delete the run of printable bytes around a position, which
+             empties a string or a token. */
+
+          u32 strip_from = HAVOC_POS(temp_len), strip_to = strip_from;
+
+          if (out_buf[strip_from] < 0x20 || out_buf[strip_from] > 0x7e) {
+
+            break;
+
+          }
+
+          while (strip_from && out_buf[strip_from - 1] >= 0x20 &&
+                 out_buf[strip_from - 1] <= 0x7e) {
+
+            --strip_from;
+
+          }
+
+          while (strip_to < temp_len && out_buf[strip_to] >= 0x20 &&
+                 out_buf[strip_to] <= 0x7e) {
+
+            ++strip_to;
+
+          }
+
+          if (strip_to - strip_from == temp_len) { break; }
+
+          memmove(out_buf + strip_from, out_buf + strip_to,
+                  temp_len - strip_to);
+          temp_len -= strip_to - strip_from;
+          break;
+
+        }
+
+#endif
         default:
 
           r -= (MAX_HAVOC_ENTRY + 1);
@@ -2759,7 +3008,7 @@ havoc_stage:
 
               if (extra_len > temp_len) { break; }
 
-              u32 insert_at = rand_below(afl, temp_len - extra_len + 1);
+              u32 insert_at = HAVOC_POS(temp_len - extra_len + 1);
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " EXTRA_OVERWRITE-%u-%u",
                        insert_at, extra_len);
@@ -2777,7 +3026,7 @@ havoc_stage:
               if (temp_len + extra_len >= MAX_FILE) { break; }
 
               u8 *ptr = afl->extras[use_extra].data;
-              u32 insert_at = rand_below(afl, temp_len + 1);
+              u32 insert_at = HAVOC_POS(temp_len + 1);
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " EXTRA_INSERT-%u-%u",
                        insert_at, extra_len);
@@ -2824,7 +3073,7 @@ havoc_stage:
 
               if (extra_len > temp_len) { break; }
 
-              u32 insert_at = rand_below(afl, temp_len - extra_len + 1);
+              u32 insert_at = HAVOC_POS(temp_len - extra_len + 1);
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp),
                        " AUTO_EXTRA_OVERWRITE-%u-%u", insert_at, extra_len);
@@ -2842,7 +3091,7 @@ havoc_stage:
               if (temp_len + extra_len >= MAX_FILE) { break; }
 
               u8 *ptr = afl->a_extras[use_extra].data;
-              u32 insert_at = rand_below(afl, temp_len + 1);
+              u32 insert_at = HAVOC_POS(temp_len + 1);
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp),
                        " AUTO_EXTRA_INSERT-%u-%u", insert_at, extra_len);
@@ -2898,7 +3147,7 @@ havoc_stage:
             if (copy_len > temp_len) copy_len = temp_len;
 
             copy_from = rand_below(afl, new_len - copy_len + 1);
-            copy_to = rand_below(afl, temp_len - copy_len + 1);
+            copy_to = HAVOC_POS(temp_len - copy_len + 1);
 
 #ifdef INTROSPECTION
             snprintf(afl->m_tmp, sizeof(afl->m_tmp),
@@ -2916,7 +3165,7 @@ havoc_stage:
 
             clone_len = choose_block_len(afl, new_len);
             clone_from = rand_below(afl, new_len - clone_len + 1);
-            clone_to = rand_below(afl, temp_len + 1);
+            clone_to = HAVOC_POS(temp_len + 1);
 
             u8 *temp_buf = afl_realloc(AFL_BUF_PARAM(out_scratch),
                                        temp_len + clone_len + 1);
@@ -2956,6 +3205,10 @@ havoc_stage:
 
     if (common_fuzz_stuff(afl, out_buf, temp_len)) { goto abandon_entry; }
 
+#if IGORFUZZ_FEATURE_ENABLE
+    if (unlikely(reduce_mix)) { havoc_reduce_account(afl); }
+#endif
+
     /* out_buf might have been mangled a bit, so let's restore it to its
        original size and shape. */
 
@@ -3056,7 +3309,11 @@ retry_splicing:
 
     /* Split somewhere between the first and last differing byte. */
 
+#if IGORFUZZ_FEATURE_ENABLE
+    split_at = influence_pos(afl, f_diff, l_diff);
+#else
     split_at = f_diff + rand_below(afl, l_diff - f_diff);
+#endif
 
     /* Do the thing. */
 
@@ -3083,6 +3340,12 @@ retry_splicing:
 abandon_entry:
 
   afl->splicing_with = -1;
+#if IGORFUZZ_FEATURE_ENABLE
+  // operators of a havoc exec that never got accounted for
+  if (afl->havoc_reduce) {
+    memset(afl->havoc_reduce->used, 0, sizeof(afl->havoc_reduce->used));
+  }
+#endif
 
   /* Update afl->pending_not_fuzzed count if we made it through the calibration
      cycle and have not seen this entry before. */
@@ -3091,17 +3354,22 @@ abandon_entry:
       !afl->queue_cur->was_fuzzed && !afl->queue_cur->disabled) {
 
     --afl->pending_not_fuzzed;
-    afl->queue_cur->was_fuzzed = 1;
+    QUEUE_HOT_SET(afl, afl->queue_cur, was_fuzzed, 1);
     afl->reinit_table = 1;
     if (afl->queue_cur->favored) { --afl->pending_favored; }
 
   }
 
   ++afl->queue_cur->fuzz_level;
+#if IGORFUZZ_FEATURE_ENABLE
+  decrease_round(afl->queue_cur);
+  QUEUE_HOT_TOUCH(afl, afl->queue_cur);  // its weight follows fuzz_level
+#endif
   orig_in = NULL;
   return ret_val;
 
 #undef FLIP_BIT
+#undef HAVOC_POS
 
 }
 
@@ -3284,6 +3552,33 @@ static u8 mopt_common_fuzzing(afl_state_t *afl, MOpt_globals_t MOpt_globals) {
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+
+  /*********
+   * DDMIN *
+   *********/
+
+  // Done already if fuzz_one_original got the entry first (-L -1)
+  if (unlikely(afl->afl_env.igorfuzz_ddmin && afl->testcase_matrix &&
+               !afl->queue_cur->ddmin_done)) {
+
+    if (ddmin_stage(afl, in_buf, len)) { goto abandon_entry; }
+
+  }
+
+  /*************
+   * INFLUENCE *
+   *************/
+
+  if (unlikely(afl->afl_env.igorfuzz_influence && afl->matrix_edges &&
+               !afl->queue_cur->influence)) {
+
+    if (influence_stage(afl, out_buf, len)) { goto abandon_entry; }
+
+  }
+
+#endif
+
   if (unlikely(afl->shm.cmplog_mode &&
                afl->queue_cur->colorized < afl->cmplog_lvl &&
                (u32)len <= afl->cmplog_max_filesize)) {
@@ -3362,6 +3657,12 @@ static u8 mopt_common_fuzzing(afl_state_t *afl, MOpt_globals_t MOpt_globals) {
                                             \
   } while (0)
 
+#if IGORFUZZ_FEATURE_ENABLE
+  #define HAVOC_POS(_l) influence_pos(afl, 0, (_l))
+#else
+  #define HAVOC_POS(_l) rand_below(afl, (_l))
+#endif
+
   /* Single walking bit. */
 
   afl->stage_short = "flip1";
@@ -4748,6 +5049,12 @@ pacemaker_fuzzing:
 
             case 0:
               /* Flip a single bit somewhere. Spooky! */
+#if IGORFUZZ_FEATURE_ENABLE
+              // One draw as upstream, unless there is an influence map
+              if (unlikely(afl->queue_cur->influence)) {
+                FLIP_BIT(out_buf, (HAVOC_POS(temp_len) << 3) + rand_below(afl, 8));
+              } else
+#endif
               FLIP_BIT(out_buf, rand_below(afl, temp_len << 3));
               MOpt_globals.cycles_v2[STAGE_FLIP1]++;
 #ifdef INTROSPECTION
@@ -4784,7 +5091,7 @@ pacemaker_fuzzing:
 
             case 3:
               if (temp_len < 4) { break; }
-              out_buf[rand_below(afl, temp_len)] ^= 0xFF;
+              out_buf[HAVOC_POS(temp_len)] ^= 0xFF;
               MOpt_globals.cycles_v2[STAGE_FLIP8]++;
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " FLIP_BIT8");
@@ -4794,7 +5101,7 @@ pacemaker_fuzzing:
 
             case 4:
               if (temp_len < 8) { break; }
-              *(u16 *)(out_buf + rand_below(afl, temp_len - 1)) ^= 0xFFFF;
+              *(u16 *)(out_buf + HAVOC_POS(temp_len - 1)) ^= 0xFFFF;
               MOpt_globals.cycles_v2[STAGE_FLIP16]++;
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " FLIP_BIT16");
@@ -4804,7 +5111,7 @@ pacemaker_fuzzing:
 
             case 5:
               if (temp_len < 8) { break; }
-              *(u32 *)(out_buf + rand_below(afl, temp_len - 3)) ^= 0xFFFFFFFF;
+              *(u32 *)(out_buf + HAVOC_POS(temp_len - 3)) ^= 0xFFFFFFFF;
               MOpt_globals.cycles_v2[STAGE_FLIP32]++;
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " FLIP_BIT32");
@@ -4813,9 +5120,9 @@ pacemaker_fuzzing:
               break;
 
             case 6:
-              out_buf[rand_below(afl, temp_len)] -=
+              out_buf[HAVOC_POS(temp_len)] -=
                   1 + rand_below(afl, ARITH_MAX);
-              out_buf[rand_below(afl, temp_len)] +=
+              out_buf[HAVOC_POS(temp_len)] +=
                   1 + rand_below(afl, ARITH_MAX);
               MOpt_globals.cycles_v2[STAGE_ARITH8]++;
 #ifdef INTROSPECTION
@@ -4829,7 +5136,7 @@ pacemaker_fuzzing:
               if (temp_len < 8) { break; }
               if (rand_below(afl, 2)) {
 
-                u32 pos = rand_below(afl, temp_len - 1);
+                u32 pos = HAVOC_POS(temp_len - 1);
                 *(u16 *)(out_buf + pos) -= 1 + rand_below(afl, ARITH_MAX);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16-%u", pos);
@@ -4838,7 +5145,7 @@ pacemaker_fuzzing:
 
               } else {
 
-                u32 pos = rand_below(afl, temp_len - 1);
+                u32 pos = HAVOC_POS(temp_len - 1);
                 u16 num = 1 + rand_below(afl, ARITH_MAX);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16BE-%u-%u",
@@ -4853,7 +5160,7 @@ pacemaker_fuzzing:
               /* Randomly add to word, random endian. */
               if (rand_below(afl, 2)) {
 
-                u32 pos = rand_below(afl, temp_len - 1);
+                u32 pos = HAVOC_POS(temp_len - 1);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16+-%u", pos);
                 strcat(afl->mutation, afl->m_tmp);
@@ -4862,7 +5169,7 @@ pacemaker_fuzzing:
 
               } else {
 
-                u32 pos = rand_below(afl, temp_len - 1);
+                u32 pos = HAVOC_POS(temp_len - 1);
                 u16 num = 1 + rand_below(afl, ARITH_MAX);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH16BE+-%u-%u",
@@ -4882,7 +5189,7 @@ pacemaker_fuzzing:
               if (temp_len < 8) { break; }
               if (rand_below(afl, 2)) {
 
-                u32 pos = rand_below(afl, temp_len - 3);
+                u32 pos = HAVOC_POS(temp_len - 3);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32_-%u", pos);
                 strcat(afl->mutation, afl->m_tmp);
@@ -4891,7 +5198,7 @@ pacemaker_fuzzing:
 
               } else {
 
-                u32 pos = rand_below(afl, temp_len - 3);
+                u32 pos = HAVOC_POS(temp_len - 3);
                 u32 num = 1 + rand_below(afl, ARITH_MAX);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32BE_-%u-%u",
@@ -4907,7 +5214,7 @@ pacemaker_fuzzing:
               // if (temp_len < 4) break;
               if (rand_below(afl, 2)) {
 
-                u32 pos = rand_below(afl, temp_len - 3);
+                u32 pos = HAVOC_POS(temp_len - 3);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32+-%u", pos);
                 strcat(afl->mutation, afl->m_tmp);
@@ -4916,7 +5223,7 @@ pacemaker_fuzzing:
 
               } else {
 
-                u32 pos = rand_below(afl, temp_len - 3);
+                u32 pos = HAVOC_POS(temp_len - 3);
                 u32 num = 1 + rand_below(afl, ARITH_MAX);
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " ARITH32BE+-%u-%u",
@@ -4934,7 +5241,7 @@ pacemaker_fuzzing:
             case 9:
               /* Set byte to interesting value. */
               if (temp_len < 4) { break; }
-              out_buf[rand_below(afl, temp_len)] =
+              out_buf[HAVOC_POS(temp_len)] =
                   interesting_8[rand_below(afl, sizeof(interesting_8))];
               MOpt_globals.cycles_v2[STAGE_INTEREST8]++;
 #ifdef INTROSPECTION
@@ -4952,7 +5259,7 @@ pacemaker_fuzzing:
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING16");
                 strcat(afl->mutation, afl->m_tmp);
 #endif
-                *(u16 *)(out_buf + rand_below(afl, temp_len - 1)) =
+                *(u16 *)(out_buf + HAVOC_POS(temp_len - 1)) =
                     interesting_16[rand_below(afl,
                                               sizeof(interesting_16) >> 1)];
 
@@ -4962,7 +5269,7 @@ pacemaker_fuzzing:
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING16BE");
                 strcat(afl->mutation, afl->m_tmp);
 #endif
-                *(u16 *)(out_buf + rand_below(afl, temp_len - 1)) =
+                *(u16 *)(out_buf + HAVOC_POS(temp_len - 1)) =
                     SWAP16(interesting_16[rand_below(
                         afl, sizeof(interesting_16) >> 1)]);
 
@@ -4982,7 +5289,7 @@ pacemaker_fuzzing:
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING32");
                 strcat(afl->mutation, afl->m_tmp);
 #endif
-                *(u32 *)(out_buf + rand_below(afl, temp_len - 3)) =
+                *(u32 *)(out_buf + HAVOC_POS(temp_len - 3)) =
                     interesting_32[rand_below(afl,
                                               sizeof(interesting_32) >> 2)];
 
@@ -4992,7 +5299,7 @@ pacemaker_fuzzing:
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " INTERESTING32BE");
                 strcat(afl->mutation, afl->m_tmp);
 #endif
-                *(u32 *)(out_buf + rand_below(afl, temp_len - 3)) =
+                *(u32 *)(out_buf + HAVOC_POS(temp_len - 3)) =
                     SWAP32(interesting_32[rand_below(
                         afl, sizeof(interesting_32) >> 2)]);
 
@@ -5007,7 +5314,7 @@ pacemaker_fuzzing:
                  why not. We use XOR with 1-255 to eliminate the
                  possibility of a no-op. */
 
-              out_buf[rand_below(afl, temp_len)] ^= 1 + rand_below(afl, 255);
+              out_buf[HAVOC_POS(temp_len)] ^= 1 + rand_below(afl, 255);
               MOpt_globals.cycles_v2[STAGE_RANDOMBYTE]++;
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " RAND8");
@@ -5029,7 +5336,7 @@ pacemaker_fuzzing:
 
               del_len = choose_block_len(afl, temp_len - 1);
 
-              del_from = rand_below(afl, temp_len - del_len + 1);
+              del_from = HAVOC_POS(temp_len - del_len + 1);
 
 #ifdef INTROSPECTION
               snprintf(afl->m_tmp, sizeof(afl->m_tmp), " DEL-%u%u", del_from,
@@ -5068,7 +5375,7 @@ pacemaker_fuzzing:
 
                 }
 
-                clone_to = rand_below(afl, temp_len);
+                clone_to = HAVOC_POS(temp_len);
 
 #ifdef INTROSPECTION
                 snprintf(afl->m_tmp, sizeof(afl->m_tmp), " CLONE_%s-%u-%u-%u",
@@ -5125,7 +5432,7 @@ pacemaker_fuzzing:
               copy_len = choose_block_len(afl, temp_len - 1);
 
               copy_from = rand_below(afl, temp_len - copy_len + 1);
-              copy_to = rand_below(afl, temp_len - copy_len + 1);
+              copy_to = HAVOC_POS(temp_len - copy_len + 1);
 
               if (likely(rand_below(afl, 4))) {
 
@@ -5183,7 +5490,7 @@ pacemaker_fuzzing:
 
                   if (extra_len > (u32)temp_len) break;
 
-                  u32 insert_at = rand_below(afl, temp_len - extra_len + 1);
+                  u32 insert_at = HAVOC_POS(temp_len - extra_len + 1);
 #ifdef INTROSPECTION
                   snprintf(afl->m_tmp, sizeof(afl->m_tmp),
                            " AUTO_EXTRA_OVERWRITE-%u-%u", insert_at, extra_len);
@@ -5201,7 +5508,7 @@ pacemaker_fuzzing:
 
                   if (extra_len > (u32)temp_len) break;
 
-                  u32 insert_at = rand_below(afl, temp_len - extra_len + 1);
+                  u32 insert_at = HAVOC_POS(temp_len - extra_len + 1);
 #ifdef INTROSPECTION
                   snprintf(afl->m_tmp, sizeof(afl->m_tmp),
                            " EXTRA_OVERWRITE-%u-%u", insert_at, extra_len);
@@ -5223,7 +5530,7 @@ pacemaker_fuzzing:
               else if (r == 1 && (afl->extras_cnt || afl->a_extras_cnt)) {
 
                 u32 use_extra, extra_len,
-                    insert_at = rand_below(afl, temp_len + 1);
+                    insert_at = HAVOC_POS(temp_len + 1);
                 u8 *ptr;
 
                 /* Insert an extra. Do the same dice-rolling stuff as for the
@@ -5299,7 +5606,7 @@ pacemaker_fuzzing:
                   if (copy_len > temp_len) copy_len = temp_len;
 
                   copy_from = rand_below(afl, new_len - copy_len + 1);
-                  copy_to = rand_below(afl, temp_len - copy_len + 1);
+                  copy_to = HAVOC_POS(temp_len - copy_len + 1);
 
 #ifdef INTROSPECTION
                   snprintf(afl->m_tmp, sizeof(afl->m_tmp),
@@ -5317,7 +5624,7 @@ pacemaker_fuzzing:
 
                   clone_len = choose_block_len(afl, new_len);
                   clone_from = rand_below(afl, new_len - clone_len + 1);
-                  clone_to = rand_below(afl, temp_len + 1);
+                  clone_to = HAVOC_POS(temp_len + 1);
 
                   u8 *temp_buf = afl_realloc(AFL_BUF_PARAM(out_scratch),
                                              temp_len + clone_len + 1);
@@ -5361,6 +5668,10 @@ pacemaker_fuzzing:
         ++*MOpt_globals.pTime;
 
         u64 temp_total_found = afl->queued_items + afl->saved_crashes;
+#if IGORFUZZ_FEATURE_ENABLE
+        u32 temp_bitmap_size = afl->min_bitmap_size;
+        u64 temp_actual_cnts = afl->min_actual_cnts;
+#endif
 
         if (common_fuzz_stuff(afl, out_buf, temp_len)) {
 
@@ -5397,6 +5708,12 @@ pacemaker_fuzzing:
 
           u64 temp_temp_puppet =
               afl->queued_items + afl->saved_crashes - temp_total_found;
+#if IGORFUZZ_FEATURE_ENABLE
+          // weigh a find by the reduction it made
+          if (afl->testcase_matrix)
+            temp_temp_puppet = mopt_find_weight(
+                afl, temp_temp_puppet, temp_bitmap_size, temp_actual_cnts);
+#endif
           afl->total_puppet_find = afl->total_puppet_find + temp_temp_puppet;
 
           if (MOpt_globals.is_pilot_mode) {
@@ -5510,7 +5827,11 @@ pacemaker_fuzzing:
 
         /* Split somewhere between the first and last differing byte. */
 
+#if IGORFUZZ_FEATURE_ENABLE
+        split_at = influence_pos(afl, f_diff, l_diff);
+#else
         split_at = f_diff + rand_below(afl, l_diff - f_diff);
+#endif
 
         /* Do the thing. */
 
@@ -5558,7 +5879,7 @@ pacemaker_fuzzing:
           if (!afl->queue_cur->was_fuzzed) {
 
             --afl->pending_not_fuzzed;
-            afl->queue_cur->was_fuzzed = 1;
+            QUEUE_HOT_SET(afl, afl->queue_cur, was_fuzzed, 1);
             if (afl->queue_cur->favored) { --afl->pending_favored; }
 
           }
@@ -5701,11 +6022,16 @@ pacemaker_fuzzing:
   }                                                                /* block */
 
   ++afl->queue_cur->fuzz_level;
+#if IGORFUZZ_FEATURE_ENABLE
+  decrease_round(afl->queue_cur);
+  QUEUE_HOT_TOUCH(afl, afl->queue_cur);  // its weight follows fuzz_level
+#endif
   return ret_val;
 
 }
 
 #undef FLIP_BIT
+#undef HAVOC_POS
 
 u8 core_fuzzing(afl_state_t *afl) {
 
@@ -0,0 +1,384 @@
+/*
+   IgorFuzz - pool of PoCs reduced by one afl-fuzz
+   -----------------------------------------------
+
+   Given a directory with -i, every regular file in it is a PoC reduced
+   on its own: it has its own matrix, virgin maps, minimums and queue,
+   and its findings go to <out_dir>/pocs/<name>/. They all share the
+   forkserver, the shared memory, the symbolizer and the symbol cache,
+   which is what a batch of single PoC runs keeps paying for.
+
+   The PoCs take turns on the fuzzer in time slices. The per-PoC part
+   of afl_state_t is swapped out at the end of a slice and the next PoC
+   is drawn with weights from its recent finds, so PoCs still shrinking
+   get more slices while those stuck get just enough to notice a change.
+
+   Path frequencies (n_fuzz), extras, MOpt and the testcase cache stay
+   shared across the pool.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include "afl-fuzz.h"
+
+#if IGORFUZZ_FEATURE_ENABLE
+
+#include <dirent.h>
+
+// Score of a queued entry in a slice. Scores halve every slice.
+#define POC_POOL_FIND_SCORE 16
+#define POC_POOL_MAX_SCORE  (1U << 16)
+
+// Fields of afl_state_t owned by each PoC of the pool
+#define POC_SLOT_FIELDS(X)                                                   \
+  X(in_file) X(out_dir)                                                      \
+  X(queue) X(queue_cur) X(queue_top) X(queue_buf) X(top_rated)              \
+  X(alias_probability) X(alias_table) X(active_items) X(reinit_table)        \
+  X(virgin_bits) X(virgin_tmout) X(virgin_crash) X(var_bytes)                \
+  X(queued_items) X(queued_variable) X(queued_at_start) X(queued_discovered) \
+  X(queued_favored) X(queued_with_cov) X(pending_not_fuzzed)                 \
+  X(pending_favored) X(cur_skipped_items) X(cur_depth) X(max_depth)          \
+  X(useless_at_start) X(var_byte_count) X(current_entry)                     \
+  X(total_crashes) X(saved_crashes) X(total_tmouts) X(saved_tmouts)          \
+  X(saved_hangs) X(queue_cycle) X(cycles_wo_finds) X(last_find_time)         \
+  X(last_crash_time) X(last_hang_time) X(total_bitmap_size)                  \
+  X(total_bitmap_entries) X(ready_for_splicing_count) X(score_changed)       \
+  X(expand_havoc) X(havoc_stack_pow2)                                        \
+  X(testcase_matrix) X(min_actual_cnts) X(min_bitmap_size)                   \
+  X(matrix_edges) X(matrix_edges_cnt) X(touched_words) X(touched_words_cnt)  \
+  X(touched_words_stale) X(min_edge_hits)                                    \
+  X(cull_edges) X(cull_winners) X(cull_snaps) X(cull_picks)                  \
+  X(cull_picks_size) X(cull_dirty) X(q_hot)                                  \
+  X(last_decrease_time) X(last_decrease_execs) X(last_decrease_stamp)        \
+  X(plateau_reached)                                                         \
+  X(queued_dominated) X(sampler) X(sampler_built) X(weight_avg)              \
+  X(queue_store) X(queued_collected) X(ddmin_seen)
+
+// and of its forkserver, the crash site of the matrix in LV3
+#define POC_SLOT_FSRV_FIELDS(X) \
+  X(crash_symbol) X(crash_module) X(crash_offset)
+
+struct poc_slot {
+
+#define POC_SLOT_FIELD(f) __typeof__(((afl_state_t *)0)->f) f;
+  POC_SLOT_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+#define POC_SLOT_FIELD(f) __typeof__(((afl_forkserver_t *)0)->f) f;
+  POC_SLOT_FSRV_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+
+  // locals of the main loop
+  u32 runs_in_current_cycle;
+  u64 prev_queued;
+
+  u32 slice_queued;  // entries ever queued when its slice began
+  u32 score;         // finds of recent slices
+
+  // when it was swapped out, its plateau only counts its own slices
+  u64 swapped_ms, swapped_execs;
+
+};
+
+struct poc_pool {
+
+  struct poc_slot *slots;
+  u32 cnt, cur;
+  u8 *in_dir;
+  u64 slice_start;
+
+};
+
+static void poc_slot_save(afl_state_t *afl, struct poc_slot *s) {
+#define POC_SLOT_FIELD(f) s->f = afl->f;
+  POC_SLOT_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+#define POC_SLOT_FIELD(f) s->f = afl->fsrv.f;
+  POC_SLOT_FSRV_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+}
+
+static void poc_slot_load(afl_state_t *afl, struct poc_slot *s) {
+#define POC_SLOT_FIELD(f) afl->f = s->f;
+  POC_SLOT_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+#define POC_SLOT_FIELD(f) afl->fsrv.f = s->f;
+  POC_SLOT_FSRV_FIELDS(POC_SLOT_FIELD)
+#undef POC_SLOT_FIELD
+}
+
+/* A PoC nothing has been done for yet, like afl_state_init and main leave it */
+static void poc_slot_fresh(afl_state_t *afl, struct poc_slot *s) {
+  u32 map_size = afl->fsrv.map_size;
+
+  s->virgin_bits = ck_alloc(map_size);
+  s->virgin_tmout = ck_alloc(map_size);
+  s->virgin_crash = ck_alloc(map_size);
+  s->var_bytes = ck_alloc(map_size);
+  s->top_rated = ck_alloc(map_size * sizeof(void *));
+
+  if (afl->in_bitmap) {
+    read_bitmap(afl->in_bitmap, s->virgin_bits, map_size);
+  } else {
+    memset(s->virgin_bits, 255, map_size);
+  }
+  memset(s->virgin_tmout, 255, map_size);
+  memset(s->virgin_crash, 255, map_size);
+
+  s->havoc_stack_pow2 = HAVOC_STACK_POW2;
+  s->min_actual_cnts = UINT64_MAX;
+  s->min_bitmap_size = UINT32_MAX;
+  s->touched_words_stale = 1;
+  s->runs_in_current_cycle = (u32)-1;
+}
+
+static void poc_slot_mkdirs(u8 *dir) {
+  static const char *subdirs[] = {
+    "", "/queue", "/queue/.state", "/queue/.state/deterministic_done",
+    "/queue/.state/auto_extras", "/queue/.state/redundant_edges",
+    "/queue/.state/variable_behavior", "/queue/.state/dominated",
+    "/crashes", "/hangs"
+  };
+
+  for (u32 i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); ++i) {
+    u8 *tmp = alloc_printf("%s%s", dir, subdirs[i]);
+    if (mkdir(tmp, 0700)) { PFATAL("Unable to create '%s'", tmp); }
+    ck_free(tmp);
+  }
+}
+
+/**
+ * Turn -i into a pool if it names a directory, then make its
+ * first PoC the current one for read_the_testcase.
+*/
+void poc_pool_init(afl_state_t *afl) {
+  struct stat st;
+  struct dirent **nl;
+
+  if (afl->in_place_resume || stat(afl->in_file, &st) || !S_ISDIR(st.st_mode))
+    return;
+
+  // Findings of others would land in whichever PoC is current
+  if (afl->sync_id && strcmp(afl->sync_id, "default"))
+    FATAL("A pool of PoCs can't be used with -M or -S");
+
+  s32 nl_cnt = scandir(afl->in_file, &nl, NULL, alphasort);
+  if (nl_cnt < 0) { PFATAL("Unable to open '%s'", afl->in_file); }
+
+  struct poc_pool *pool = ck_alloc(sizeof(struct poc_pool));
+  pool->slots = ck_alloc(nl_cnt * sizeof(struct poc_slot));
+  pool->in_dir = afl->in_file;
+
+  u8 *tmp = alloc_printf("%s/pocs", afl->root_out_dir);
+  if (mkdir(tmp, 0700)) { PFATAL("Unable to create '%s'", tmp); }
+  ck_free(tmp);
+
+  for (s32 i = 0; i < nl_cnt; ++i) {
+    u8 *fn = alloc_printf("%s/%s", afl->in_file, nl[i]->d_name);
+
+    if (nl[i]->d_name[0] == '.' || lstat(fn, &st) || !S_ISREG(st.st_mode)) {
+      ck_free(fn);
+    } else if (!st.st_size) {
+      WARNF("Skipping empty PoC '%s'", fn);
+      ck_free(fn);
+    } else {
+      struct poc_slot *s = &pool->slots[pool->cnt++];
+      s->in_file = fn;
+      s->out_dir = alloc_printf("%s/pocs/%s", afl->root_out_dir, nl[i]->d_name);
+      poc_slot_mkdirs(s->out_dir);
+    }
+
+    free(nl[i]);  // not tracked
+  }
+  free(nl);  // not tracked
+
+  if (!pool->cnt) { FATAL("No PoCs found in '%s'", afl->in_file); }
+  OKF("Reducing a pool of %u PoCs.", pool->cnt);
+
+  // The first PoC goes through main just like a single one
+  afl->in_file = pool->slots[0].in_file;
+  afl->out_dir = pool->slots[0].out_dir;
+  afl->poc_pool = pool;
+}
+
+/**
+ * Dry run the rest of the pool, each PoC as perform_dry_run
+ * and cull_queue already did for the first one within main.
+*/
+void poc_pool_dry_run(afl_state_t *afl) {
+  struct poc_pool *pool = afl->poc_pool;
+
+  poc_slot_save(afl, &pool->slots[0]);
+  pool->slots[0].runs_in_current_cycle = (u32)-1;
+
+  for (u32 i = 1; i < pool->cnt && !afl->stop_soon; ++i) {
+    struct poc_slot *s = &pool->slots[i];
+
+    poc_slot_fresh(afl, s);
+    poc_slot_load(afl, s);
+
+    read_the_testcase(afl);
+    pivot_inputs(afl);
+    perform_dry_run(afl);
+    cull_queue(afl);
+
+    poc_slot_save(afl, s);
+  }
+
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    pool->slots[i].slice_queued =
+      pool->slots[i].queued_items + pool->slots[i].queued_collected;
+    pool->slots[i].score = POC_POOL_FIND_SCORE;
+    pool->slots[i].swapped_ms = get_cur_time();
+    pool->slots[i].swapped_execs = afl->fsrv.total_execs;
+    pool->slots[i].last_decrease_time = pool->slots[i].swapped_ms;
+    pool->slots[i].last_decrease_execs = pool->slots[i].swapped_execs;
+  }
+
+  poc_slot_load(afl, &pool->slots[0]);
+  pool->slice_start = get_cur_time();
+}
+
+static inline u32 poc_slot_weight(struct poc_slot *s) {
+  return s->plateau_reached ? 0 : 1 + s->score;
+}
+
+/**
+ * At the end of a time slice, swap the current PoC out and the next
+ * one in. The main loop keeps a couple of its own locals per PoC.
+*/
+void poc_pool_schedule(afl_state_t *afl, u32 *runs_in_current_cycle,
+                       u64 *prev_queued) {
+  struct poc_pool *pool = afl->poc_pool;
+  u64 cur_ms = get_cur_time();
+
+  if (cur_ms - pool->slice_start < IGORFUZZ_POC_SLICE_MS) { return; }
+
+  // Go on with the current one if there is no other left
+  u32 total = 0, next = 0;
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    if (i != pool->cur && !pool->slots[i].plateau_reached) { ++total; }
+  }
+  if (!total) {
+    pool->slice_start = cur_ms;
+    return;
+  }
+
+  struct poc_slot *s = &pool->slots[pool->cur];
+  s->score = MIN((s->score >> 1) +
+    (afl->queued_items + afl->queued_collected - s->slice_queued) *
+      POC_POOL_FIND_SCORE,
+    POC_POOL_MAX_SCORE);
+  s->runs_in_current_cycle = *runs_in_current_cycle;
+  s->prev_queued = *prev_queued;
+  s->swapped_ms = cur_ms;
+  s->swapped_execs = afl->fsrv.total_execs;
+  poc_slot_save(afl, s);
+
+  // Weighted draw, everyone not converged keeps a weight of at least 1
+  total = 0;
+  for (u32 i = 0; i < pool->cnt; ++i) { total += poc_slot_weight(&pool->slots[i]); }
+  u32 r = rand_below(afl, total);
+  while (r >= poc_slot_weight(&pool->slots[next]))
+    r -= poc_slot_weight(&pool->slots[next++]);
+
+  s = &pool->slots[next];
+  s->last_decrease_time += cur_ms - s->swapped_ms;
+  s->last_decrease_execs += afl->fsrv.total_execs - s->swapped_execs;
+  poc_slot_load(afl, s);
+  *runs_in_current_cycle = s->runs_in_current_cycle;
+  *prev_queued = s->prev_queued;
+  s->slice_queued = afl->queued_items + afl->queued_collected;
+
+  // The main loop only knows the alias table of the last one
+  afl->reinit_table = 1;
+  pool->cur = next;
+  pool->slice_start = cur_ms;
+}
+
+/* PoCs in the pool, 1 without one */
+u32 poc_pool_size(afl_state_t *afl) {
+  return afl->poc_pool ? afl->poc_pool->cnt : 1;
+}
+
+/**
+ * The current PoC reached IGORFUZZ_PLATEAU. It gets no more slices,
+ * and the run is over once all PoCs of the pool are done.
+*/
+void poc_pool_converged(afl_state_t *afl) {
+  struct poc_pool *pool = afl->poc_pool;
+
+  if (afl->plateau_reached) { return; }
+  afl->plateau_reached = 1;
+  write_stats_file(afl, count_non_255_bytes(afl, afl->virgin_bits), 0, 0, 0);
+
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    if (i != pool->cur && !pool->slots[i].plateau_reached) {
+      pool->slice_start = 0;  // switch right away
+      return;
+    }
+  }
+
+  afl->stop_soon = 2;
+}
+
+/**
+ * Free all but the current PoC, which goes with the usual
+ * cleanup of main. Must come before destroy_queue.
+*/
+void poc_pool_destroy(afl_state_t *afl) {
+  struct poc_pool *pool = afl->poc_pool;
+  if (!pool) { return; }
+
+  poc_slot_save(afl, &pool->slots[pool->cur]);
+
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    struct poc_slot *s = &pool->slots[i];
+
+    if (i != pool->cur) {
+      poc_slot_load(afl, s);
+      destroy_queue(afl);
+      afl_free(s->queue_buf);
+      afl_free(s->alias_table);
+      afl_free(s->alias_probability);
+      ck_free(s->virgin_bits);
+      ck_free(s->virgin_tmout);
+      ck_free(s->virgin_crash);
+      ck_free(s->var_bytes);
+      ck_free(s->top_rated);
+      ck_free(s->matrix_edges);
+      ck_free(s->cull_edges);
+      ck_free(s->cull_winners);
+      ck_free(s->cull_snaps);
+      ck_free(s->touched_words);
+      ck_free(s->min_edge_hits);
+      ck_free(s->ddmin_seen);
+      ck_free(s->crash_symbol);
+      ck_free(s->crash_module);
+    }
+  }
+
+  poc_slot_load(afl, &pool->slots[pool->cur]);
+
+  // The run as a whole only converged with all of its PoCs
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    if (!pool->slots[i].plateau_reached) { afl->plateau_reached = 0; }
+  }
+
+  for (u32 i = 0; i < pool->cnt; ++i) {
+    ck_free(pool->slots[i].in_file);
+    ck_free(pool->slots[i].out_dir);
+  }
+
+  afl->in_file = pool->in_dir;
+  afl->out_dir = afl->root_out_dir;
+  ck_free(pool->slots);
+  ck_free(pool);
+  afl->poc_pool = NULL;
+}
+
+#endif // IGORFUZZ_FEATURE_ENABLE
@@ -254,6 +254,8 @@ static py_mutator_t *init_py_module(afl_state_t *afl, u8 *module_name) {
     if (py_functions[PY_FUNC_SPLICE_OPTOUT]) { afl->custom_splice_optout = 1; }
     py_functions[PY_FUNC_QUEUE_NEW_ENTRY] =
         PyObject_GetAttrString(py_module, "queue_new_entry");
+    py_functions[PY_FUNC_REDUCE_FEEDBACK] =
+        PyObject_GetAttrString(py_module, "reduce_feedback");
     py_functions[PY_FUNC_INTROSPECTION] =
         PyObject_GetAttrString(py_module, "introspection");
     py_functions[PY_FUNC_DEINIT] = PyObject_GetAttrString(py_module, "deinit");
@@ -481,6 +483,16 @@ struct custom_mutator *load_custom_mutator_py(afl_state_t *afl,
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (py_functions[PY_FUNC_REDUCE_FEEDBACK]) {
+
+    mutator->afl_custom_reduce_feedback = reduce_feedback_py;
+    afl->custom_reduce_feedback = 1;
+
+  }
+
+  #endif
+
   #ifdef INTROSPECTION
   if (py_functions[PY_FUNC_INTROSPECTION]) {
 
@@ -996,6 +1008,45 @@ u8 queue_new_entry_py(void *py_mutator, const u8 *filename_new_queue,
 
 }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+void reduce_feedback_py(void *py_mutator, const struct reduce_feedback *fb) {
+
+  PyObject *py_args, *py_value;
+
+  // Same order as struct reduce_feedback, strings and NULL as str and None
+  py_args = Py_BuildValue(
+      "(BBBBIKIKzzIz)", fb->result, fb->fault, fb->few_bits, fb->same_site,
+      fb->bitmap_size, (unsigned long long)fb->actual_counts,
+      fb->min_bitmap_size, (unsigned long long)fb->min_actual_cnts,
+      (const char *)fb->crash_module, (const char *)fb->crash_symbol,
+      fb->crash_offset, (const char *)fb->fname);
+  if (!py_args) {
+
+    PyErr_Print();
+    FATAL("Failed to convert arguments");
+
+  }
+
+  py_value = PyObject_CallObject(
+      ((py_mutator_t *)py_mutator)->py_functions[PY_FUNC_REDUCE_FEEDBACK],
+      py_args);
+  Py_DECREF(py_args);
+
+  if (py_value != NULL) {
+
+    Py_DECREF(py_value);
+
+  } else {
+
+    PyErr_Print();
+    FATAL("Call failed");
+
+  }
+
+}
+
+  #endif
+
   #undef BUF_PARAMS
 
 #endif                                                        /* USE_PYTHON */
@@ -47,6 +47,23 @@ void run_afl_custom_queue_new_entry(afl_state_t *afl, struct queue_entry *q,
 
 inline u32 select_next_queue_entry(afl_state_t *afl) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (afl->afl_env.igorfuzz_fenwick) {
+
+    // Nothing left to weigh, the alias table falls back to uniform then.
+    // total may have drifted off 0, every pick would be drawn again.
+    if (unlikely(!afl->sampler.live)) {
+
+      return rand_below(afl, afl->queued_items);
+
+    }
+
+    return sampler_pick(&afl->sampler, rand_next_percent(afl));
+
+  }
+
+#endif
+
   u32    s = rand_below(afl, afl->queued_items);
   double p = rand_next_percent(afl);
   /*
@@ -58,12 +75,40 @@ inline u32 select_next_queue_entry(afl_state_t *afl) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* The decrease yield of q over its last rounds, finds per round */
+static inline double decrease_yield(struct queue_entry *q) {
+  return (1.0 + q->decrease_recent) / (1.0 + q->decrease_rounds);
+}
+#endif
+
 double compute_weight(afl_state_t *afl, struct queue_entry *q,
                       double avg_exec_us, double avg_bitmap_size,
                       double avg_top_size) {
 
   double weight = 1.0;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  // How far below the matrix the entry is, and how much fuzzing it yielded
+  if (afl->schedule == DECREASE && likely(afl->testcase_matrix)) {
+
+    struct queue_entry *m = afl->testcase_matrix;
+
+    weight *= (avg_exec_us / q->exec_us);
+    weight *= (double)m->bitmap_size / MAX(q->bitmap_size, 1U);
+    weight *= sqrt((double)(m->actual_counts + 1) / (q->actual_counts + 1));
+    weight *= sqrt((double)m->len / q->len);
+    weight *= decrease_yield(q);
+
+    if (unlikely(weight < 0.1)) { weight = 0.1; }
+    if (unlikely(q->favored)) { weight *= 5; }
+    if (unlikely(!q->was_fuzzed)) { weight *= 2; }
+
+    return weight;
+
+  }
+#endif
+
   if (likely(afl->schedule >= FAST && afl->schedule <= RARE)) {
 
     u32 hits = afl->n_fuzz[q->n_fuzz_entry];
@@ -83,6 +128,26 @@ double compute_weight(afl_state_t *afl, struct queue_entry *q,
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* All entries touched so far have been weighed again. */
+
+static void queue_hot_settle(afl_state_t *afl) {
+
+  struct queue_hot *h = &afl->q_hot;
+  u32               i;
+
+  for (i = 0; i < h->touched_cnt; ++i) {
+
+    h->stale[h->touched[i]] = 0;
+
+  }
+
+  h->touched_cnt = 0;
+
+}
+
+#endif
+
 /* create the alias table that allows weighted random selection - expensive */
 
 void create_alias_table(afl_state_t *afl) {
@@ -114,6 +179,23 @@ void create_alias_table(afl_state_t *afl) {
     double avg_top_size = 0.0;
     u32    active = 0;
 
+#if IGORFUZZ_FEATURE_ENABLE
+    struct queue_hot *h = &afl->q_hot;
+
+    for (i = 0; i < n; i++) {
+
+      // disabled entries might have timings and bitmap values
+      if (likely(!h->disabled[i])) {
+
+        avg_exec_us += h->exec_us[i];
+        avg_bitmap_size += log(h->bitmap_size[i]);
+        avg_top_size += h->tc_ref[i];
+        ++active;
+
+      }
+
+    }
+#else
     for (i = 0; i < n; i++) {
 
       struct queue_entry *q = afl->queue_buf[i];
@@ -129,19 +211,32 @@ void create_alias_table(afl_state_t *afl) {
       }
 
     }
+#endif
 
     avg_exec_us /= active;
     avg_bitmap_size /= active;
     avg_top_size /= active;
 
+#if IGORFUZZ_FEATURE_ENABLE
+    afl->weight_avg.exec_us = avg_exec_us;
+    afl->weight_avg.bitmap_size = avg_bitmap_size;
+    afl->weight_avg.top_size = avg_top_size;
+#endif
+
     for (i = 0; i < n; i++) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+      // Disabled entries get no score, leave their cold fields alone
+      if (unlikely(h->disabled[i])) { continue; }
+#endif
+
       struct queue_entry *q = afl->queue_buf[i];
 
       if (likely(!q->disabled)) {
 
-        q->weight =
-            compute_weight(afl, q, avg_exec_us, avg_bitmap_size, avg_top_size);
+        QUEUE_HOT_SET(afl, q, weight,
+                      compute_weight(afl, q, avg_exec_us, avg_bitmap_size,
+                                     avg_top_size));
         q->perf_score = calculate_score(afl, q);
         sum += q->weight;
 
@@ -157,18 +252,31 @@ void create_alias_table(afl_state_t *afl) {
 
         struct queue_entry *q = afl->queue_buf[i];
 
-        if (likely(!q->disabled)) { q->weight *= 2.0; }
+        if (likely(!q->disabled)) {
+
+          QUEUE_HOT_SET(afl, q, weight, q->weight * 2.0);
+
+        }
 
       }
 
     }
 
+#if IGORFUZZ_FEATURE_ENABLE
+    for (i = 0; i < n; i++) {
+
+      // weight is always 0 for disabled entries
+      P[i] = (h->weight[i] * n) / sum;
+
+    }
+#else
     for (i = 0; i < n; i++) {
 
       // weight is always 0 for disabled entries
       P[i] = (afl->queue_buf[i]->weight * n) / sum;
 
     }
+#endif
 
   } else {
 
@@ -232,6 +340,9 @@ void create_alias_table(afl_state_t *afl) {
     afl->alias_probability[S[--nS]] = 1;
 
   afl->reinit_table = 0;
+#if IGORFUZZ_FEATURE_ENABLE
+  queue_hot_settle(afl);
+#endif
 
   /*
   #ifdef INTROSPECTION
@@ -272,6 +383,90 @@ void create_alias_table(afl_state_t *afl) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* What the sampler draws entry i by, as P[i] of create_alias_table. */
+
+static inline double sampler_weight(afl_state_t *afl, u32 i) {
+
+  if (unlikely(afl->q_hot.disabled[i])) { return 0; }
+  if (likely(afl->schedule < RARE)) { return afl->q_hot.weight[i]; }
+  return afl->queue_buf[i]->perf_score;
+
+}
+
+/* Bring the IGORFUZZ_FENWICK sampler up to date with the queue. Entries
+   written to since the last update are weighed again, and new ones
+   join, in O(log n) each rather than the O(n) of create_alias_table.
+
+   They are weighed with the averages of the last full build. Those
+   mostly scale all weights alike, but drift nonetheless, as do the
+   n_fuzz hits of the FAST family. So the full build is redone once the
+   queue doubled, and always for MMOPT, which boosts the newest five.
+   It is also redone after IGORFUZZ_FENWICK_REBUILD updates, which each
+   round the prefix sums they pass through. */
+
+void update_sampler(afl_state_t *afl) {
+
+  struct queue_hot *h = &afl->q_hot;
+  struct sampler   *s = &afl->sampler;
+  u32               n = afl->queued_items, i, k;
+
+  if (!s->cnt || n >= 2 * afl->sampler_built || afl->schedule == MMOPT ||
+      s->updates >= IGORFUZZ_FENWICK_REBUILD) {
+
+    create_alias_table(afl);
+
+    double *w = (double *)afl_realloc(AFL_BUF_PARAM(out), n * sizeof(double));
+    if (unlikely(!w)) { PFATAL("alloc"); }
+    for (i = 0; i < n; ++i) {
+
+      w[i] = sampler_weight(afl, i);
+
+    }
+
+    sampler_build(s, w, n);
+    afl->sampler_built = n;
+    return;
+
+  }
+
+  for (k = 0; k < h->touched_cnt; ++k) {
+
+    i = h->touched[k];
+    struct queue_entry *q = afl->queue_buf[i];
+
+    if (likely(!q->disabled)) {
+
+      if (likely(afl->schedule < RARE)) {
+
+        QUEUE_HOT_SET(afl, q, weight,
+                      compute_weight(afl, q, afl->weight_avg.exec_us,
+                                     afl->weight_avg.bitmap_size,
+                                     afl->weight_avg.top_size));
+
+      }
+
+      q->perf_score = calculate_score(afl, q);
+
+    }
+
+    if (i < s->cnt) { sampler_set(s, i, sampler_weight(afl, i)); }
+
+  }
+
+  for (i = s->cnt; i < n; ++i) {
+
+    sampler_push(s, sampler_weight(afl, i));
+
+  }
+
+  queue_hot_settle(afl);
+  afl->reinit_table = 0;
+
+}
+
+#endif
+
 /* Mark deterministic checks as done for a particular queue entry. We use the
    .state file to avoid repeating deterministic fuzzing when resuming aborted
    scans. */
@@ -448,11 +643,30 @@ static u8 check_if_text(afl_state_t *afl, struct queue_entry *q) {
   ssize_t comp;
 
   if (len >= MAX_FILE) len = MAX_FILE - 1;
+#if IGORFUZZ_FEATURE_ENABLE
+  if (q->store_buf) {
+
+    buf = (u8 *)afl_realloc(AFL_BUF_PARAM(in_scratch), len + 1);
+    memcpy(buf, q->store_buf, len);
+    comp = len;
+
+  } else {
+
+    if ((fd = open((char *)q->fname, O_RDONLY)) < 0) return 0;
+    buf = (u8 *)afl_realloc(AFL_BUF_PARAM(in_scratch), len + 1);
+    comp = read(fd, buf, len);
+    close(fd);
+    if (comp != (ssize_t)len) return 0;
+
+  }
+
+#else
   if ((fd = open((char *)q->fname, O_RDONLY)) < 0) return 0;
   buf = (u8 *)afl_realloc(AFL_BUF_PARAM(in_scratch), len + 1);
   comp = read(fd, buf, len);
   close(fd);
   if (comp != (ssize_t)len) return 0;
+#endif
   buf[len] = 0;
 
   while (offset < len) {
@@ -547,6 +761,41 @@ static u8 check_if_text(afl_state_t *afl, struct queue_entry *q) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* Make room for q in the hot arrays and take its fields as they are. */
+
+static void queue_hot_add(afl_state_t *afl, struct queue_entry *q) {
+
+  struct queue_hot *h = &afl->q_hot;
+
+  if (unlikely(q->id >= h->size)) {
+    h->size = MAX(h->size * 2, 64U);
+    h->exec_us = ck_realloc(h->exec_us, h->size * sizeof(u64));
+    h->bitmap_size = ck_realloc(h->bitmap_size, h->size * sizeof(u32));
+    h->tc_ref = ck_realloc(h->tc_ref, h->size * sizeof(u32));
+    h->n_fuzz_entry = ck_realloc(h->n_fuzz_entry, h->size * sizeof(u32));
+    h->weight = ck_realloc(h->weight, h->size * sizeof(double));
+    h->favored = ck_realloc(h->favored, h->size * sizeof(bool));
+    h->was_fuzzed = ck_realloc(h->was_fuzzed, h->size * sizeof(bool));
+    h->disabled = ck_realloc(h->disabled, h->size * sizeof(bool));
+    h->touched = ck_realloc(h->touched, h->size * sizeof(u32));
+    h->stale = ck_realloc(h->stale, h->size * sizeof(bool));
+  }
+
+  h->exec_us[q->id] = q->exec_us;
+  h->bitmap_size[q->id] = q->bitmap_size;
+  h->tc_ref[q->id] = q->tc_ref;
+  h->n_fuzz_entry[q->id] = q->n_fuzz_entry;
+  h->weight[q->id] = q->weight;
+  h->favored[q->id] = q->favored;
+  h->was_fuzzed[q->id] = q->was_fuzzed;
+  h->disabled[q->id] = q->disabled;
+  h->stale[q->id] = 0;
+  QUEUE_HOT_TOUCH(afl, q);
+
+}
+#endif
+
 /* Append new test case to the queue. */
 
 void add_to_queue(afl_state_t *afl, u8 *fname, u32 len, u8 passed_det) {
@@ -591,6 +840,11 @@ void add_to_queue(afl_state_t *afl, u8 *fname, u32 len, u8 passed_det) {
   if (unlikely(!queue_buf)) { PFATAL("alloc"); }
   queue_buf[afl->queued_items - 1] = q;
   q->id = afl->queued_items - 1;
+#if IGORFUZZ_FEATURE_ENABLE
+  queue_hot_add(afl, q);
+  q->store_buf = queue_store_claim(afl, fname);
+  q->name_id = q->id + afl->queued_collected;
+#endif
 
   u64 cur_time = get_cur_time();
 
@@ -637,6 +891,11 @@ void destroy_queue(afl_state_t *afl) {
 
   u32 i;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  queue_store_export(afl);
+  queue_store_close(afl);
+#endif
+
   for (i = 0; i < afl->queued_items; i++) {
 
     struct queue_entry *q;
@@ -644,12 +903,105 @@ void destroy_queue(afl_state_t *afl) {
     q = afl->queue_buf[i];
     ck_free(q->fname);
     ck_free(q->trace_mini);
+#if IGORFUZZ_FEATURE_ENABLE
+    ck_free(q->lost_edges);
+    ck_free(q->influence);
+#endif
     ck_free(q);
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  struct queue_hot *h = &afl->q_hot;
+  ck_free(h->exec_us);
+  ck_free(h->bitmap_size);
+  ck_free(h->tc_ref);
+  ck_free(h->n_fuzz_entry);
+  ck_free(h->weight);
+  ck_free(h->favored);
+  ck_free(h->was_fuzzed);
+  ck_free(h->disabled);
+  ck_free(h->touched);
+  ck_free(h->stale);
+  memset(h, 0, sizeof(struct queue_hot));
+  sampler_free(&afl->sampler);
+#endif
+
+}
+
+#if IGORFUZZ_FEATURE_ENABLE
+/* Index the map positions touched by the matrix, in ascending order.
+   Coverage-decrease can only happen there, so scoring and culling
+   don't need to walk the whole map. */
+
+static void build_matrix_edges(afl_state_t *afl, u8 *trace_mini) {
+
+  u32 i, cnt = 0;
+
+  for (i = 0; i < afl->fsrv.map_size; ++i) {
+    if (trace_mini[i >> 3] & (1 << (i & 7))) { ++cnt; }
+  }
+
+  afl->matrix_edges = ck_realloc(afl->matrix_edges, MAX(cnt, 1U) * sizeof(u32));
+  afl->matrix_edges_cnt = 0;
+
+  for (i = 0; i < afl->fsrv.map_size; ++i) {
+    if (trace_mini[i >> 3] & (1 << (i & 7)))
+      { afl->matrix_edges[afl->matrix_edges_cnt++] = i; }
+  }
+
+  // Snapshots are sized by the edge count, the next cull starts over
+  ck_free(afl->cull_snaps);
+  afl->cull_snaps = NULL;
+  afl->cull_picks = afl->cull_picks_size = afl->cull_dirty = 0;
+
 }
 
+/* Index of map position i in matrix_edges, which must hold it. */
+
+static u32 matrix_edge_index(afl_state_t *afl, u32 i) {
+
+  u32 lo = 0, hi = afl->matrix_edges_cnt;
+
+  while (hi - lo > 1) {
+    u32 mid = (lo + hi) >> 1;
+    if (afl->matrix_edges[mid] <= i) { lo = mid; } else { hi = mid; }
+  }
+
+  return lo;
+
+}
+
+/* minimize_bits, from the non-zero positions listed by trace_nonzero. */
+
+static void minimize_nonzero(afl_state_t *afl, u8 *dst) {
+
+  u32 k;
+
+  for (k = 0; k < afl->trace_nz_cnt; ++k)
+    { dst[afl->trace_nz[k] >> 3] |= 1 << (afl->trace_nz[k] & 7); }
+
+}
+
+/* The matrix edges `q` no longer touches, as a bitset over indices of
+   matrix_edges. Taken once from its trace_mini, culling then clears
+   them from temp_v a word at a time. */
+
+static void build_lost_edges(afl_state_t *afl, struct queue_entry *q) {
+
+  u32 k, words = (afl->matrix_edges_cnt + 63) >> 6;
+
+  q->lost_edges = ck_alloc(MAX(words, 1U) * sizeof(u64));
+
+  for (k = 0; k < afl->matrix_edges_cnt; ++k) {
+    u32 i = afl->matrix_edges[k];
+    if (!(q->trace_mini[i >> 3] & (1 << (i & 7))))
+      { q->lost_edges[k >> 6] |= 1ULL << (k & 63); }
+  }
+
+}
+#endif
+
 /* When we bump into a new path, we call this to see if the path appears
    more "favorable" than any of the existing ones. The purpose of the
    "favorables" is to have a minimal set of paths that trigger all the bits
@@ -685,17 +1037,33 @@ void update_bitmap_score(afl_state_t *afl, struct queue_entry *q) {
   }
 
 #if IGORFUZZ_FEATURE_ENABLE
+  // Calibration may have listed the non-zero bytes already
+  if (!afl->trace_nz_fresh) { trace_nonzero(afl); }
+  afl->trace_nz_fresh = 0;
+
   // Make sure the matrix has its trace_mini
   if (unlikely(q == afl->testcase_matrix && !q->trace_mini)) {
     u32 len = (afl->fsrv.map_size >> 3);
     q->trace_mini = (u8 *)ck_alloc(len);
-    minimize_bits(afl, q->trace_mini, afl->fsrv.trace_bits);
+    minimize_nonzero(afl, q->trace_mini);
   }
+  if (unlikely(q == afl->testcase_matrix && !afl->matrix_edges))
+    { build_matrix_edges(afl, q->trace_mini); }
 #endif
 
   /* For every byte set in afl->fsrv.trace_bits[], see if there is a previous
      winner, and how it compares to us. */
+#if IGORFUZZ_FEATURE_ENABLE
+  // Once the matrix is there, only its edges are worth competing for
+  u8 *matrix = afl->matrix_edges ? afl->testcase_matrix->trace_mini : NULL;
+  u32 k;
+  for (k = 0; k < afl->trace_nz_cnt; ++k) {
+
+    i = afl->trace_nz[k];
+    if (matrix && !(matrix[i >> 3] & (1 << (i & 7)))) { continue; }
+#else
   for (i = 0; i < afl->fsrv.map_size; ++i) {
+#endif
 
     if (afl->fsrv.trace_bits[i]) {
 
@@ -752,14 +1120,24 @@ void update_bitmap_score(afl_state_t *afl, struct queue_entry *q) {
 #if IGORFUZZ_FEATURE_ENABLE
         if (afl->top_rated[i] == afl->testcase_matrix) {
           if (afl->testcase_matrix->tc_ref > 0) {
-              afl->testcase_matrix->tc_ref -= 1;
+              QUEUE_HOT_SET(afl, afl->testcase_matrix, tc_ref,
+                            afl->testcase_matrix->tc_ref - 1);
           } // keep trace_mini of matrix forever
         } else {
 #endif
+#if IGORFUZZ_FEATURE_ENABLE
+        struct queue_entry *prev = afl->top_rated[i];
+        if (!QUEUE_HOT_SET(afl, prev, tc_ref, prev->tc_ref - 1)) {
+#else
         if (!--afl->top_rated[i]->tc_ref) {
+#endif
 
           ck_free(afl->top_rated[i]->trace_mini);
           afl->top_rated[i]->trace_mini = 0;
+#if IGORFUZZ_FEATURE_ENABLE
+          ck_free(afl->top_rated[i]->lost_edges);
+          afl->top_rated[i]->lost_edges = 0;
+#endif
 
         }
 #if IGORFUZZ_FEATURE_ENABLE
@@ -771,16 +1149,26 @@ void update_bitmap_score(afl_state_t *afl, struct queue_entry *q) {
       /* Insert ourselves as the new winner. */
 
       afl->top_rated[i] = q;
-      ++q->tc_ref;
+      QUEUE_HOT_SET(afl, q, tc_ref, q->tc_ref + 1);
 
       if (!q->trace_mini) {
 
         u32 len = (afl->fsrv.map_size >> 3);
         q->trace_mini = (u8 *)ck_alloc(len);
+#if IGORFUZZ_FEATURE_ENABLE
+        minimize_nonzero(afl, q->trace_mini);
+#else
         minimize_bits(afl, q->trace_mini, afl->fsrv.trace_bits);
+#endif
 
       }
 
+#if IGORFUZZ_FEATURE_ENABLE
+      if (!q->lost_edges && afl->matrix_edges) { build_lost_edges(afl, q); }
+      // the next cull keeps what it picked before this edge
+      afl->cull_dirty = matrix ? MIN(afl->cull_dirty, matrix_edge_index(afl, i)) : 0;
+#endif
+
       afl->score_changed = 1;
 
     }
@@ -789,6 +1177,177 @@ void update_bitmap_score(afl_state_t *afl, struct queue_entry *q) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* IGORFUZZ_PARETO: an entry is dominated if another one is no worse in
+   bitmap_size, actual_counts and len, and better in one of them. Such
+   variants lead nowhere a frontier entry doesn't lead faster. exec_us
+   is timing noise, and would make equal entries dominate each other
+   at random from one cull to the next. */
+
+static inline u8 pareto_dominates(struct queue_entry *a, struct queue_entry *b) {
+  if (a->bitmap_size > b->bitmap_size || a->actual_counts > b->actual_counts ||
+      a->len > b->len) { return 0; }
+  return a->bitmap_size < b->bitmap_size || a->actual_counts < b->actual_counts ||
+         a->len < b->len;
+}
+
+// Lexicographic on the axes, so dominators always come first; exec_us
+// only breaks ties
+static int pareto_cmp(const void *x, const void *y) {
+  struct queue_entry *a = *(struct queue_entry **)x, *b = *(struct queue_entry **)y;
+  if (a->bitmap_size != b->bitmap_size) { return a->bitmap_size < b->bitmap_size ? -1 : 1; }
+  if (a->actual_counts != b->actual_counts) { return a->actual_counts < b->actual_counts ? -1 : 1; }
+  if (a->len != b->len) { return a->len < b->len ? -1 : 1; }
+  if (a->exec_us != b->exec_us) { return a->exec_us < b->exec_us ? -1 : 1; }
+  return 0;
+}
+
+// Reserve order: not yet fuzzed first, then the newest
+static int pareto_reserve_cmp(const void *x, const void *y) {
+  struct queue_entry *a = *(struct queue_entry **)x, *b = *(struct queue_entry **)y;
+  if (a->was_fuzzed != b->was_fuzzed) { return a->was_fuzzed ? 1 : -1; }
+  return a->id < b->id ? 1 : -1;
+}
+
+static void pareto_move_aside(afl_state_t *afl, struct queue_entry *q) {
+  u8 *fn = strrchr(q->fname, '/');
+  fn = alloc_printf("%s/queue/.state/dominated/%s", afl->out_dir, fn ? fn + 1 : q->fname);
+  // Entries in the queue store only have a file once exported
+  if (q->store_buf) {
+    queue_store_move(afl, q, fn);
+  } else if (rename(q->fname, fn)) {
+    PFATAL("Unable to move '%s'", q->fname);
+  }
+  ck_free(q->fname);
+  q->fname = fn;
+}
+
+/* Disable the entries off the Pareto frontier, except for the matrix
+   and pareto_reserve of the rest, so only the frontier and a few
+   dominated entries are scheduled. Dominance is transitive,
+   so checking against the frontier found so far is enough. */
+
+static void cull_dominated(afl_state_t *afl) {
+  struct queue_entry **cand = ck_alloc(afl->queued_items * sizeof(struct queue_entry *));
+  struct queue_entry **doms = ck_alloc(afl->queued_items * sizeof(struct queue_entry *));
+  u32 i, j, cnt = 0, front = 0, dom = 0;
+
+  for (i = 0; i < afl->queued_items; ++i) {
+    if (!afl->q_hot.disabled[i]) { cand[cnt++] = afl->queue_buf[i]; }
+  }
+  qsort(cand, cnt, sizeof(struct queue_entry *), pareto_cmp);
+
+  // cand[0, front) is the frontier, never past the candidate at hand
+  for (i = 0; i < cnt; ++i) {
+    struct queue_entry *q = cand[i];
+    for (j = 0; j < front && !pareto_dominates(cand[j], q); ++j) {}
+    if (j == front) {
+      cand[front++] = q;
+    } else if (q != afl->testcase_matrix) {
+      doms[dom++] = q;
+    }
+  }
+
+  if (dom > afl->pareto_reserve) {
+    qsort(doms, dom, sizeof(struct queue_entry *), pareto_reserve_cmp);
+    for (i = afl->pareto_reserve; i < dom; ++i) {
+      struct queue_entry *q = doms[i];
+      QUEUE_HOT_SET(afl, q, disabled, 1);
+      q->perf_score = 0;
+      if (!q->was_fuzzed) {
+        QUEUE_HOT_SET(afl, q, was_fuzzed, 1);
+        --afl->pending_not_fuzzed;
+        --afl->active_items;
+      }
+      if (afl->afl_env.igorfuzz_pareto_move) { pareto_move_aside(afl, q); }
+      ++afl->queued_dominated;
+    }
+    afl->reinit_table = 1;
+  }
+
+  ck_free(cand);
+  ck_free(doms);
+}
+
+static inline void cull_favor(afl_state_t *afl, struct queue_entry *q) {
+  if (q->favored) { return; }
+  QUEUE_HOT_SET(afl, q, favored, 1);
+  ++afl->queued_favored;
+  if (!q->was_fuzzed) { ++afl->pending_favored; }
+}
+
+/* Grab winners of matrix edges still set in temp_v, in matrix edge
+   order, as the upstream cull does for the whole map. Here the bits a
+   winner removes are the matrix edges it no longer touches: any
+   disappeared tuple is what we desire, coverage-decrease rather than
+   -increase.
+
+   Picks before cull_dirty saw the same winners and the same temp_v as
+   last time, so they stand and temp_v is restored from the snapshot
+   taken after the last of them. Only the edges from cull_dirty on are
+   walked again. */
+
+static void cull_favored(afl_state_t *afl) {
+
+  u32 words = (afl->matrix_edges_cnt + 63) >> 6;
+  u64 *temp = (u64 *)afl->map_tmp_buf;
+  u32 k, n, p;
+
+  // A winner disabled since then changes things from its edge on
+  for (p = 0; p < afl->cull_picks && afl->cull_edges[p] < afl->cull_dirty; ++p) {
+    if (afl->cull_winners[p]->disabled) { afl->cull_dirty = afl->cull_edges[p]; break; }
+  }
+
+  afl->queued_favored = 0;
+  afl->pending_favored = 0;
+
+  for (n = 0; n < afl->cull_picks; ++n) {
+    QUEUE_HOT_SET(afl, afl->cull_winners[n], favored, 0);
+  }
+  for (n = 0; n < p; ++n) { cull_favor(afl, afl->cull_winners[n]); }
+
+  if (p) {
+    memcpy(temp, afl->cull_snaps + (size_t)(p - 1) * words, words * sizeof(u64));
+  } else {
+    memset(temp, 255, words * sizeof(u64));
+  }
+  afl->cull_picks = p;
+
+  for (k = afl->cull_dirty; k < afl->matrix_edges_cnt; ++k) {
+
+    if (!(temp[k >> 6] & (1ULL << (k & 63)))) { continue; }
+
+    struct queue_entry *q = afl->top_rated[afl->matrix_edges[k]];
+
+    //A disabled winner would hold pending_favored up forever.
+    if (!q || afl->q_hot.disabled[q->id]) { continue; }
+
+    if (unlikely(!q->lost_edges)) { build_lost_edges(afl, q); }
+    for (n = 0; n < words; ++n) { temp[n] &= ~q->lost_edges[n]; }
+
+    cull_favor(afl, q);
+
+    if (afl->cull_picks == afl->cull_picks_size) {
+      afl->cull_picks_size = MAX(afl->cull_picks_size * 2, 16U);
+      afl->cull_edges = ck_realloc(afl->cull_edges, afl->cull_picks_size * sizeof(u32));
+      afl->cull_winners = ck_realloc(afl->cull_winners,
+        afl->cull_picks_size * sizeof(struct queue_entry *));
+      afl->cull_snaps = ck_realloc(afl->cull_snaps,
+        (size_t)afl->cull_picks_size * words * sizeof(u64));
+    }
+
+    afl->cull_edges[afl->cull_picks] = k;
+    afl->cull_winners[afl->cull_picks] = q;
+    memcpy(afl->cull_snaps + (size_t)afl->cull_picks * words, temp, words * sizeof(u64));
+    ++afl->cull_picks;
+
+  }
+
+  afl->cull_dirty = afl->matrix_edges_cnt;
+
+}
+#endif
+
 /* The second part of the mechanism discussed above is a routine that
    goes over afl->top_rated[] entries, and then sequentially grabs winners for
    previously-unseen bytes (temp_v) and marks them as favored, at least
@@ -804,12 +1363,24 @@ void cull_queue(afl_state_t *afl) {
 
   if (likely(!afl->score_changed || afl->non_instrumented_mode)) { return; }
 
-  u32 len = (afl->fsrv.map_size >> 3);
   u32 i;
-  u8 *temp_v = afl->map_tmp_buf;
 
   afl->score_changed = 0;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (unlikely(!afl->matrix_edges)) {
+    if (unlikely(!afl->testcase_matrix->trace_mini))
+      { FATAL("The matrix has not been calibrated!"); }
+    build_matrix_edges(afl, afl->testcase_matrix->trace_mini);
+  }
+
+  if (afl->afl_env.igorfuzz_pareto) { cull_dominated(afl); }
+
+  cull_favored(afl);
+#else
+  u32 len = (afl->fsrv.map_size >> 3);
+  u8 *temp_v = afl->map_tmp_buf;
+
   memset(temp_v, 255, len);
 
   afl->queued_favored = 0;
@@ -834,25 +1405,11 @@ void cull_queue(afl_state_t *afl) {
 
       while (j--) {
 
-#if IGORFUZZ_FEATURE_ENABLE
-        u8 *trated = afl->top_rated[i]->trace_mini;
-        u8 *matrix = afl->testcase_matrix->trace_mini;
-        //Here the removed bits are matrix has but trated doesn't have.
-        //Because any disappeared tuple in trace_bits indicates that 
-        //there is an edge which is no longer touched - we desire for
-        //coverage-decrease rather than -increase.
-        if ((trated[j] ^ matrix[j]) & matrix[j]) {
-
-          temp_v[j] &= ~((trated[j] ^ matrix[j]) & matrix[j]);
-
-        }
-#else
         if (afl->top_rated[i]->trace_mini[j]) {
 
           temp_v[j] &= ~afl->top_rated[i]->trace_mini[j];
 
         }
-#endif
 
       }
 
@@ -868,6 +1425,7 @@ void cull_queue(afl_state_t *afl) {
     }
 
   }
+#endif
 
   for (i = 0; i < afl->queued_items; i++) {
 
@@ -1032,6 +1590,15 @@ u32 calculate_score(afl_state_t *afl, struct queue_entry *q) {
       factor = MAX_FACTOR;
       break;
 
+    case DECREASE:
+      // Don't modify perf_score for unfuzzed seeds
+      if (!q->fuzz_level) break;
+
+      // Energy follows the recent decrease yield of the entry
+      factor = decrease_yield(q);
+      if (factor < 0.25) { factor = 0.25; }
+      break;
+
     case COE:
       fuzz_mu = 0.0;
       n_items = 0;
@@ -1040,6 +1607,18 @@ u32 calculate_score(afl_state_t *afl, struct queue_entry *q) {
       if (!q->fuzz_level) break;
 
       u32 i;
+#if IGORFUZZ_FEATURE_ENABLE
+      for (i = 0; i < afl->queued_items; i++) {
+
+        if (likely(!afl->q_hot.disabled[i])) {
+
+          fuzz_mu += log2(afl->n_fuzz[afl->q_hot.n_fuzz_entry[i]]);
+          n_items++;
+
+        }
+
+      }
+#else
       for (i = 0; i < afl->queued_items; i++) {
 
         if (likely(!afl->queue_buf[i]->disabled)) {
@@ -1050,6 +1629,7 @@ u32 calculate_score(afl_state_t *afl, struct queue_entry *q) {
         }
 
       }
+#endif
 
       if (unlikely(!n_items)) { FATAL("Queue state corrupt"); }
 
@@ -1244,6 +1824,121 @@ inline void queue_testcase_retake_mem(afl_state_t *afl, struct queue_entry *q,
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* Cached testcases that must stay: queue_cur, whose buffer is in use,
+   and with IGORFUZZ_CACHE_PIN the matrix and the favored entries. */
+
+static inline u8 testcase_pinned(afl_state_t *afl, struct queue_entry *q) {
+
+  return q == afl->queue_cur ||
+         (afl->afl_env.igorfuzz_cache_pin &&
+          (q == afl->testcase_matrix || q->favored));
+
+}
+
+/* Only testcases that leave room for plenty of others get cached,
+   pinned ones as long as they fit in half of the cache. */
+
+static inline u8 testcase_admit(afl_state_t *afl, struct queue_entry *q) {
+
+  u64 max = afl->q_testcase_max_cache_size;
+
+  if (q->len <= max / IGORFUZZ_CACHE_ADMIT_DIV) { return 1; }
+  return testcase_pinned(afl, q) && q->len < max / 2;
+
+}
+
+/* CLOCK: the hand sweeps the cache and evicts the first testcase not
+   used since it last came by, clearing the reference bit of those that
+   were. If two sweeps left only pinned ones, pins give way bar
+   queue_cur's. Returns -1 if nothing can go. */
+
+static u32 testcase_evict(afl_state_t *afl) {
+
+  u32 n = afl->q_testcase_max_cache_count, i, tid;
+
+  for (i = 0; i < 3 * n; ++i) {
+
+    if (afl->q_testcase_clock_hand >= n) { afl->q_testcase_clock_hand = 0; }
+    tid = afl->q_testcase_clock_hand++;
+
+    struct queue_entry *q = afl->q_testcase_cache[tid];
+    if (!q || q == afl->queue_cur) { continue; }
+
+    if (i < 2 * n) {
+
+      if (testcase_pinned(afl, q)) { continue; }
+      if (q->testcase_ref) {
+
+        q->testcase_ref = 0;
+        continue;
+
+      }
+
+    }
+
+    return tid;
+
+  }
+
+  return (u32)-1;
+
+}
+
+/* Evict until a testcase of len fits in. */
+
+static u8 testcase_make_room(afl_state_t *afl, u32 len) {
+
+  while (unlikely(
+      afl->q_testcase_cache_size + len >= afl->q_testcase_max_cache_size ||
+      afl->q_testcase_cache_count >= afl->q_testcase_max_cache_entries - 1)) {
+
+    u32 tid = testcase_evict(afl);
+    if (unlikely(tid == (u32)-1)) { return 0; }
+
+    struct queue_entry *old_cached = afl->q_testcase_cache[tid];
+    free(old_cached->testcase_buf);
+    old_cached->testcase_buf = NULL;
+    afl->q_testcase_cache_size -= old_cached->len;
+    afl->q_testcase_cache[tid] = NULL;
+    --afl->q_testcase_cache_count;
+    ++afl->q_testcase_evictions;
+    if (tid < afl->q_testcase_smallest_free)
+      afl->q_testcase_smallest_free = tid;
+
+  }
+
+  return 1;
+
+}
+
+/* Register the buffer of q in the lowest free slot, so the hand has
+   no holes to skip. Everything below q_testcase_smallest_free is
+   taken. */
+
+static void testcase_register(afl_state_t *afl, struct queue_entry *q) {
+
+  u32 tid = afl->q_testcase_smallest_free;
+
+  while (unlikely(afl->q_testcase_cache[tid] != NULL))
+    ++tid;
+
+  afl->q_testcase_cache[tid] = q;
+  afl->q_testcase_cache_size += q->len;
+  ++afl->q_testcase_cache_count;
+  afl->q_testcase_smallest_free = tid + 1;
+  q->testcase_ref = 1;
+
+  if (tid >= afl->q_testcase_max_cache_count) {
+
+    afl->q_testcase_max_cache_count = tid + 1;
+
+  }
+
+}
+
+#endif
+
 /* Returns the testcase buf from the file behind this queue entry.
   Increases the refcount. */
 
@@ -1251,6 +1946,89 @@ inline u8 *queue_testcase_get(afl_state_t *afl, struct queue_entry *q) {
 
   u32 len = q->len;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  // Zero-copy from the queue store, but queue_cur gets trimmed in place
+  if (q->store_buf) {
+
+    if (likely(q != afl->queue_cur)) { return q->store_buf; }
+
+    u8 *buf = (u8 *)afl_realloc((void **)&afl->testcase_buf, len);
+
+    if (unlikely(!buf)) {
+
+      PFATAL("Unable to malloc '%s' with len %u", (char *)q->fname, len);
+
+    }
+
+    memcpy(buf, q->store_buf, len);
+    return buf;
+
+  }
+
+  if (likely(afl->q_testcase_max_cache_size)) {
+
+    if (likely(q->testcase_buf)) {
+
+      q->testcase_ref = 1;
+      ++afl->q_testcase_hits;
+      return q->testcase_buf;
+
+    }
+
+    ++afl->q_testcase_misses;
+
+    if (likely(testcase_admit(afl, q) && testcase_make_room(afl, len))) {
+
+      int fd = open((char *)q->fname, O_RDONLY);
+
+      if (unlikely(fd < 0)) { PFATAL("Unable to open '%s'", (char *)q->fname); }
+
+      q->testcase_buf = (u8 *)malloc(len);
+
+      if (unlikely(!q->testcase_buf)) {
+
+        PFATAL("Unable to malloc '%s' with len %u", (char *)q->fname, len);
+
+      }
+
+      ck_read(fd, q->testcase_buf, len, q->fname);
+      close(fd);
+
+      testcase_register(afl, q);
+      return q->testcase_buf;
+
+    }
+
+  }
+
+  /* not cached, and not going to be */
+
+  u8 *buf;
+
+  if (unlikely(q == afl->queue_cur)) {
+
+    buf = (u8 *)afl_realloc((void **)&afl->testcase_buf, len);
+
+  } else {
+
+    buf = (u8 *)afl_realloc((void **)&afl->splicecase_buf, len);
+
+  }
+
+  if (unlikely(!buf)) {
+
+    PFATAL("Unable to malloc '%s' with len %u", (char *)q->fname, len);
+
+  }
+
+  int fd = open((char *)q->fname, O_RDONLY);
+
+  if (unlikely(fd < 0)) { PFATAL("Unable to open '%s'", (char *)q->fname); }
+
+  ck_read(fd, buf, len, q->fname);
+  close(fd);
+  return buf;
+#else
   /* first handle if no testcase cache is configured */
 
   if (unlikely(!afl->q_testcase_max_cache_size)) {
@@ -1398,6 +2176,7 @@ inline u8 *queue_testcase_get(afl_state_t *afl, struct queue_entry *q) {
   }
 
   return q->testcase_buf;
+#endif
 
 }
 
@@ -1408,6 +2187,30 @@ inline void queue_testcase_store_mem(afl_state_t *afl, struct queue_entry *q,
 
   u32 len = q->len;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  // New entries don't push others out, they come back through the hand.
+  // Those in the queue store are already mapped.
+  if (unlikely(q->store_buf || !testcase_admit(afl, q) ||
+               afl->q_testcase_cache_size + len >=
+                   afl->q_testcase_max_cache_size ||
+               afl->q_testcase_cache_count >=
+                   afl->q_testcase_max_cache_entries - 1)) {
+
+    return;
+
+  }
+
+  q->testcase_buf = (u8 *)malloc(len);
+
+  if (unlikely(!q->testcase_buf)) {
+
+    PFATAL("Unable to malloc '%s' with len %u", (char *)q->fname, len);
+
+  }
+
+  memcpy(q->testcase_buf, mem, len);
+  testcase_register(afl, q);
+#else
   if (unlikely(afl->q_testcase_cache_size + len >=
                    afl->q_testcase_max_cache_size ||
                afl->q_testcase_cache_count >=
@@ -1461,6 +2264,145 @@ inline void queue_testcase_store_mem(afl_state_t *afl, struct queue_entry *q,
     afl->q_testcase_smallest_free = tid + 1;
 
   }
+#endif
 
 }
 
+
+#if IGORFUZZ_FEATURE_ENABLE
+/* Entries disabled for good. The matrix and queue_cur stay, whatever
+   they are, so the main loop has them where it left them. */
+
+static inline u8 queue_gc_collectable(afl_state_t *afl, struct queue_entry *q) {
+  return q->disabled && q != afl->testcase_matrix && q != afl->queue_cur;
+}
+
+/* Free q and what hangs off it. Returns the bytes that were freed. */
+
+static u64 queue_gc_free(afl_state_t *afl, struct queue_entry *q) {
+  u64 bytes = sizeof(struct queue_entry) + strlen(q->fname) + 1;
+  u32 tid;
+
+  // Its file stays, written out now if it only was in the queue store
+  queue_store_evict(q);
+
+  if (q->testcase_buf) {
+    for (tid = 0; tid < afl->q_testcase_max_cache_count; ++tid) {
+      if (afl->q_testcase_cache[tid] != q) { continue; }
+      afl->q_testcase_cache[tid] = NULL;
+      afl->q_testcase_cache_size -= q->len;
+      --afl->q_testcase_cache_count;
+      if (tid < afl->q_testcase_smallest_free)
+        afl->q_testcase_smallest_free = tid;
+      break;
+    }
+    free(q->testcase_buf);
+    bytes += q->len;
+  }
+
+  if (q->trace_mini) { bytes += afl->fsrv.map_size >> 3; }
+  if (q->lost_edges) {
+    bytes += MAX((afl->matrix_edges_cnt + 63) >> 6, 1U) * sizeof(u64);
+  }
+  if (q->influence) {
+    bytes += sizeof(struct influence_map) + q->influence->blocks * sizeof(u32);
+  }
+  if (q->cmplog_colorinput) { bytes += q->len; }
+  while (q->taint) {
+    struct tainted *t = q->taint->next;
+    ck_free(q->taint);
+    q->taint = t;
+    bytes += sizeof(struct tainted);
+  }
+
+  ck_free(q->fname);
+  ck_free(q->trace_mini);
+  ck_free(q->lost_edges);
+  ck_free(q->influence);
+  ck_free(q->cmplog_colorinput);
+  ck_free(q);
+  return bytes;
+}
+
+/**
+ * With IGORFUZZ_QUEUE_GC, free the entries disabled for good once
+ * there are queue_gc_min of them, and close the gaps they leave in
+ * queue_buf. Their files keep their names, ids of the entries after
+ * them move down. What points to them is cleared first: top_rated,
+ * the picks of the incremental cull and mothers. What is indexed by
+ * id is rebuilt: the hot arrays here, the alias table or the sampler
+ * before the next selection. Returns how many entries went.
+*/
+u32 queue_gc(afl_state_t *afl) {
+  struct queue_hot *h = &afl->q_hot;
+  u32 n = afl->queued_items, gone = 0, i, j, p;
+
+  for (i = 0; i < n; ++i) {
+    if (h->disabled[i] && queue_gc_collectable(afl, afl->queue_buf[i])) { ++gone; }
+  }
+  if (gone < afl->queue_gc_min) { return 0; }
+
+  for (i = 0; i < afl->fsrv.map_size; ++i) {
+    if (afl->top_rated[i] && queue_gc_collectable(afl, afl->top_rated[i]))
+      { afl->top_rated[i] = NULL; }
+  }
+
+  // Picks from the first collected winner on are made again
+  for (p = 0; p < afl->cull_picks; ++p) {
+    if (queue_gc_collectable(afl, afl->cull_winners[p])) { break; }
+  }
+  if (p < afl->cull_picks) {
+    afl->cull_dirty = MIN(afl->cull_dirty, afl->cull_edges[p]);
+    for (j = p; j < afl->cull_picks; ++j) {
+      struct queue_entry *q = afl->cull_winners[j];
+      if (!queue_gc_collectable(afl, q)) { QUEUE_HOT_SET(afl, q, favored, 0); }
+    }
+    afl->cull_picks = p;
+  }
+
+  for (i = 0; i < n; ++i) {
+    struct queue_entry *q = afl->queue_buf[i];
+    if (q->mother && queue_gc_collectable(afl, q->mother)) { q->mother = NULL; }
+  }
+
+  // Nothing is left to reweigh, the next selection rebuilds it all
+  queue_hot_settle(afl);
+
+  for (i = 0, j = 0; i < n; ++i) {
+    struct queue_entry *q = afl->queue_buf[i];
+
+    if (queue_gc_collectable(afl, q)) {
+      if (q->len > 4 && afl->ready_for_splicing_count)
+        { --afl->ready_for_splicing_count; }
+      afl->queue_gc_bytes += queue_gc_free(afl, q);
+      continue;
+    }
+
+    afl->queue_buf[j] = q;
+    q->id = j;
+    h->exec_us[j] = h->exec_us[i];
+    h->bitmap_size[j] = h->bitmap_size[i];
+    h->tc_ref[j] = h->tc_ref[i];
+    h->n_fuzz_entry[j] = h->n_fuzz_entry[i];
+    h->weight[j] = h->weight[i];
+    h->favored[j] = h->favored[i];
+    h->was_fuzzed[j] = h->was_fuzzed[i];
+    h->disabled[j] = h->disabled[i];
+    ++j;
+  }
+
+  afl->queued_items = j;
+  afl->queued_collected += gone;
+  afl->queue = afl->queue_buf[0];
+  afl->queue_top = afl->queue_buf[j - 1];
+  if (afl->queue_cur) { afl->current_entry = afl->queue_cur->id; }
+  afl->splicing_with = -1;
+
+  afl->sampler.cnt = 0;
+  afl->sampler_built = 0;
+  afl->reinit_table = 1;
+  afl->score_changed = 1;
+
+  return gone;
+}
+#endif
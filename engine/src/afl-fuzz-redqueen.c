@@ -2881,6 +2881,9 @@ exit_its:
     memcpy(virgin_save, afl->virgin_bits, afl->shm.map_size);
     // reset virgin bits to the backup previous to redqueen
     memcpy(afl->virgin_bits, virgin_backup, afl->shm.map_size);
+  #if IGORFUZZ_FEATURE_ENABLE
+    afl->touched_words_stale = 1;
+  #endif
 
     u8 status = 0;
     its_fuzz(afl, cbuf, len, &status);
@@ -2907,6 +2910,9 @@ exit_its:
     }
 
   #endif
+  #if IGORFUZZ_FEATURE_ENABLE
+    afl->touched_words_stale = 1;
+  #endif
 
   #ifdef _DEBUG
     dump("COMB", cbuf, len);
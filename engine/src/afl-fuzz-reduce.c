@@ -0,0 +1,436 @@
+/*
+   IgorFuzz - stages aimed at reduction
+   ------------------------------------
+
+   The effector map of bitflip 8/8 only tells whether a byte changes
+   the path at all. What a reduction wants to know is which bytes, when
+   changed, make the path shorter and still crash at the same site.
+
+   With IGORFUZZ_INFLUENCE, each queue entry gets probed once before it
+   is fuzzed: its bytes are cut into at most IGORFUZZ_INFLUENCE_BLOCKS
+   blocks, each block is changed on its own and run, and the matrix
+   edges the run left untouched are counted if it crashed at the same
+   site. The counts are kept on the entry as its influence map. Havoc,
+   MOpt's included, and splicing then draw most of their positions from
+   the blocks that removed the most edges (see influence_pos in
+   afl-fuzz-one.c), instead of spreading them evenly over the PoC.
+
+   With IGORFUZZ_DDMIN, each new entry is also shrunk byte-wise by
+   delta debugging before it is fuzzed. trim_case keeps a cut only if
+   the checksum of the path stays the same, and afl-tmin knows nothing
+   about the crash site. The oracle here is the one the queue is made
+   of: the candidate crashes at the same site, and save_if_interesting
+   either takes it as a decrease or finds nothing decreased (0x10).
+   Halves, quarters and so on down to single bytes are cut off the end,
+   removed and zeroed. A candidate that passes with a decrease is queued
+   on the way, one without is only shrunk further.
+
+   With IGORFUZZ_HAVOC_REDUCE, havoc draws its operators from a mix of
+   its own once a matrix is there. Deleting, zeroing, truncating and
+   setting numbers to 0, 1 or half their value shrink a path far more
+   often than cloning and inserting, which mostly grow it. Each operator
+   is scored by what has_few_bits said of the execs it took part in,
+   and the mix follows the scores like MOpt's pso_updating.
+
+   MOpt itself (-L) counts every new entry of an operator as one find.
+   With a matrix, mopt_find_weight makes a find count by the reduction
+   it brought: what has_few_bits said of it, plus how far it lowered
+   min_bitmap_size and min_actual_cnts.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include "afl-fuzz.h"
+
+#if IGORFUZZ_FEATURE_ENABLE
+
+/* Run one candidate the way common_fuzz_stuff runs a mutation. If lost
+   is not NULL, it gets the matrix edges the exec didn't touch before the
+   exec is judged, or 0 if it didn't crash at the site of the matrix. If
+   saved is not NULL, it gets whether the exec crashed and got queued.
+   Returns 1 to bail. */
+
+static u8 reduce_run(afl_state_t *afl, u8 *buf, u32 len, u32 *lost,
+                     u8 *saved) {
+
+  u32 k;
+  u8  fault, res;
+
+  if (lost) { *lost = 0; }
+  if (saved) { *saved = 0; }
+
+  if (unlikely(!(len = write_to_testcase(afl, (void **)&buf, len, 0)))) {
+    return 0;
+  }
+
+  fault = fuzz_run_target(afl, &afl->fsrv, afl->fsrv.exec_tmout);
+
+  if (afl->stop_soon) { return 1; }
+
+  if (fault == FSRV_RUN_TMOUT) {
+    if (afl->subseq_tmouts++ > TMOUT_LIMIT) {
+      ++afl->cur_skipped_items;
+      return 1;
+    }
+  } else {
+    afl->subseq_tmouts = 0;
+  }
+
+  if (afl->skip_requested) {
+    afl->skip_requested = 0;
+    ++afl->cur_skipped_items;
+    return 1;
+  }
+
+  // Raw trace_bits, an edge not hit is 0 whether classified or not
+  if (lost && fault == FSRV_RUN_CRASH && peek_crash_site(afl)) {
+    u8 *trace = afl->fsrv.trace_bits;
+    for (k = 0; k < afl->matrix_edges_cnt; ++k) {
+      if (!trace[afl->matrix_edges[k]]) { ++*lost; }
+    }
+  }
+
+  // A candidate that happens to decrease is queued like any other find
+  res = save_if_interesting(afl, buf, len, fault);
+  afl->queued_discovered += res;
+  if (saved) { *saved = res && fault == FSRV_RUN_CRASH; }
+
+  if (!(afl->stage_cur % afl->stats_update_freq) ||
+      afl->stage_cur + 1 == afl->stage_max) {
+    show_stats(afl);
+  }
+
+  return 0;
+}
+
+/**
+ * Build the influence map of queue_cur: change each block of
+ * `buf` in turn - zero its bytes, and set those already zero
+ * to 0xff - and count the matrix edges the probe removed.
+ *
+ * @param buf The testcase of queue_cur. Each block is put
+ * back after its probe.
+ * @return 1 if the entry should be abandoned, 0 otherwise.
+*/
+u8 influence_stage(afl_state_t *afl, u8 *buf, u32 len) {
+
+  struct influence_map *m;
+  u32 pow2 = 0, blocks, b, i, lost;
+  u64 orig_hit_cnt, orig_execs = afl->fsrv.total_execs;
+  u8 *orig;
+
+  while (((len - 1) >> pow2) + 1 > IGORFUZZ_INFLUENCE_BLOCKS) { ++pow2; }
+  blocks = ((len - 1) >> pow2) + 1;
+
+  orig = afl_realloc(AFL_BUF_PARAM(ex), 1U << pow2);
+  if (unlikely(!orig)) { PFATAL("alloc"); }
+
+  m = ck_alloc(sizeof(struct influence_map) + blocks * sizeof(u32));
+  m->block_pow2 = pow2;
+  m->blocks = blocks;
+
+  afl->stage_name = "influence";
+  afl->stage_short = "infl";
+  afl->stage_max = blocks;
+  afl->stage_val_type = STAGE_VAL_NONE;
+
+  orig_hit_cnt = afl->queued_items + afl->saved_crashes;
+
+  for (b = 0; b < blocks; ++b) {
+
+    u32 pos = b << pow2, n = MIN(1U << pow2, len - pos);
+
+    afl->stage_cur = b;
+    afl->stage_cur_byte = pos;
+
+    memcpy(orig, buf + pos, n);
+    for (i = pos; i < pos + n; ++i) { buf[i] = buf[i] ? 0 : 0xff; }
+
+    u8 bail = reduce_run(afl, buf, len, &lost, NULL);
+    memcpy(buf + pos, orig, n);
+
+    if (unlikely(bail)) {
+      ck_free(m);
+      return 1;
+    }
+
+    m->cdf[b] = (b ? m->cdf[b - 1] : 0) + lost;
+
+  }
+
+  afl->queue_cur->influence = m;
+
+  afl->stage_finds[STAGE_INFLUENCE] +=
+      afl->queued_items + afl->saved_crashes - orig_hit_cnt;
+  afl->stage_cycles[STAGE_INFLUENCE] += afl->fsrv.total_execs - orig_execs;
+
+  return 0;
+}
+
+/* The slot of candidate `buf` of ddmin_stage in the cache of those
+   tried, and in *key what the slot holds once buf was. The verdict of
+   the oracle keeps: the crash site doesn't move, and virgin_bits only
+   lose bits, so a candidate that decreased once finds nothing decreased
+   the next time and still passes. It is stored along, in bit 1, and no
+   candidate needs a second exec. The cache is direct-mapped and forgets
+   on collision. */
+
+static u64 *ddmin_slot(afl_state_t *afl, u8 *buf, u32 len, u64 *key) {
+
+  if (unlikely(!afl->ddmin_seen)) {
+    afl->ddmin_seen = ck_alloc(IGORFUZZ_DDMIN_CACHE * sizeof(u64));
+  }
+
+  u64 h = hash64(buf, len, HASH_CONST);
+
+  *key = (h | 1) & ~2ULL;  // 0 is a free slot
+  return &afl->ddmin_seen[h & (IGORFUZZ_DDMIN_CACHE - 1)];
+}
+
+/* Try one candidate of ddmin_stage, *ok gets whether it passed.
+   Returns 1 to bail. */
+
+static u8 ddmin_try(afl_state_t *afl, u8 *cand, u32 len, u8 *ok) {
+
+  u64 key, *slot = ddmin_slot(afl, cand, len, &key);
+
+  if ((*slot & ~2ULL) == key) {
+    ++afl->ddmin_cache_hits;
+    *ok = (*slot >> 1) & 1;
+    return 0;
+  }
+
+  if (reduce_run(afl, cand, len, NULL, ok)) { return 1; }
+  ++afl->stage_cur;
+
+  if (*ok) {
+    // Queued, and shrunk further from right here
+    afl->queue_top->ddmin_done = 1;
+  } else {
+    // Same site, nothing decreased: not worth queueing, but the crash
+    // is just as good to shrink on
+    *ok = afl->reduce_fb.fault == FSRV_RUN_CRASH && afl->last_few_bits == 0x10;
+  }
+
+  *slot = key | ((u64)*ok << 1);
+  return 0;
+}
+
+/**
+ * Shrink the testcase of queue_cur by delta debugging. For
+ * chunks of half its length, then a quarter, down to a byte:
+ * cut chunks off the end, remove each chunk, zero each chunk.
+ * A candidate passes if it crashes at the same site, queued as
+ * a decrease or with nothing decreased; the next one starts
+ * from it.
+ *
+ * @param in_buf The testcase of queue_cur, left as it is.
+ * @return 1 if the entry should be abandoned, 0 otherwise.
+*/
+u8 ddmin_stage(afl_state_t *afl, u8 *in_buf, u32 len) {
+
+  u8 *cur, *cand, ok, ret = 0;
+  u32 n = len, chunk, pos, cl, i;
+  u64 orig_hit_cnt, orig_execs = afl->fsrv.total_execs;
+
+  afl->queue_cur->ddmin_done = 1;
+  if (len < 2) { return 0; }
+
+  cur = ck_alloc_nozero(len);
+  cand = ck_alloc_nozero(len);
+  memcpy(cur, in_buf, len);
+
+  afl->stage_name = "ddmin";
+  afl->stage_short = "ddmin";
+  afl->stage_cur = 0;
+  afl->stage_max = IGORFUZZ_DDMIN_EXECS;
+  afl->stage_cur_byte = -1;
+  afl->stage_val_type = STAGE_VAL_NONE;
+
+  orig_hit_cnt = afl->queued_items + afl->saved_crashes;
+
+  for (chunk = MAX(len >> 1, 1U); afl->stage_cur < afl->stage_max;
+       chunk >>= 1) {
+
+    // Truncation, cur itself is the candidate
+    while (n > chunk && afl->stage_cur < afl->stage_max) {
+      if (ddmin_try(afl, cur, n - chunk, &ok)) { ret = 1; goto done; }
+      if (!ok) { break; }
+      n -= chunk;
+    }
+
+    // Removal, what follows a removed chunk moves into its place
+    for (pos = 0; pos < n && n > chunk && afl->stage_cur < afl->stage_max;) {
+      cl = MIN(chunk, n - pos);
+      memcpy(cand, cur, pos);
+      memcpy(cand + pos, cur + pos + cl, n - pos - cl);
+      if (ddmin_try(afl, cand, n - cl, &ok)) { ret = 1; goto done; }
+      if (ok) {
+        memcpy(cur, cand, n - cl);
+        n -= cl;
+      } else {
+        pos += cl;
+      }
+    }
+
+    // Zeroing of the chunks not all zero yet
+    for (pos = 0; pos < n && afl->stage_cur < afl->stage_max; pos += chunk) {
+      cl = MIN(chunk, n - pos);
+      for (i = pos; i < pos + cl && !cur[i]; ++i) {}
+      if (i == pos + cl) { continue; }
+      memcpy(cand, cur, n);
+      memset(cand + pos, 0, cl);
+      if (ddmin_try(afl, cand, n, &ok)) { ret = 1; goto done; }
+      if (ok) { memset(cur + pos, 0, cl); }
+    }
+
+    if (chunk == 1) { break; }
+
+  }
+
+done:
+  afl->stage_finds[STAGE_DDMIN] +=
+      afl->queued_items + afl->saved_crashes - orig_hit_cnt;
+  afl->stage_cycles[STAGE_DDMIN] += afl->fsrv.total_execs - orig_execs;
+
+  ck_free(cur);
+  ck_free(cand);
+  return ret;
+}
+
+// Starting mix of havoc_reduce, roughly how well each operator shrinks
+static const double rhavoc_init[RHAVOC_NUM] = {
+
+  [RHAVOC_DELETE] = 0.22, [RHAVOC_ZERO] = 0.14,      [RHAVOC_TRUNCATE] = 0.08,
+  [RHAVOC_MINIMAL] = 0.12, [RHAVOC_STRIP] = 0.05,    [RHAVOC_OVERWRITE] = 0.08,
+  [RHAVOC_FLIP] = 0.05,    [RHAVOC_ARITH] = 0.06,    [RHAVOC_INTEREST] = 0.04,
+  [RHAVOC_RANDOM] = 0.05,  [RHAVOC_BYTE] = 0.04,     [RHAVOC_SWITCH] = 0.03,
+  [RHAVOC_CLONE] = 0.02,   [RHAVOC_EXTRAS] = 0.02
+
+};
+
+// Bounds of an operator's share before normalizing, see v_min and v_max
+#define RHAVOC_X_MIN 0.01
+#define RHAVOC_X_MAX 1.0
+
+/* What a decrease is worth to the operators behind it. Edges gone and
+   a smaller bitmap_size count more than fewer hits. */
+
+static inline u32 decrease_score(u8 few_bits) {
+
+  if (few_bits <= 0x10) { return 0; }
+  return (few_bits & 0x01) + ((few_bits >> 3) & 0x01) +
+         ((few_bits >> 1) & 0x01) * 2 + ((few_bits >> 2) & 0x01) * 4;
+}
+
+static void havoc_reduce_norm(struct havoc_reduce *h) {
+
+  double sum = 0;
+  u32    i;
+
+  for (i = 0; i < RHAVOC_NUM; ++i) { sum += h->x[i]; }
+  for (i = 0; i < RHAVOC_NUM; ++i) {
+    h->x[i] /= sum;
+    h->cdf[i] = (i ? h->cdf[i - 1] : 0) + h->x[i];
+  }
+}
+
+void havoc_reduce_init(afl_state_t *afl) {
+
+  struct havoc_reduce *h = ck_alloc(sizeof(struct havoc_reduce));
+  u32 i;
+
+  for (i = 0; i < RHAVOC_NUM; ++i) { h->x[i] = h->L_best[i] = rhavoc_init[i]; }
+  havoc_reduce_norm(h);
+  afl->havoc_reduce = h;
+}
+
+/* One step of the swarm, like pso_updating with a single particle: each
+   operator's share moves towards the share it had at its best score per
+   use (L_best), and towards its part of all the scores so far (G_best). */
+
+static void havoc_reduce_update(afl_state_t *afl) {
+
+  struct havoc_reduce *h = afl->havoc_reduce;
+  double w, total = 0;
+  u32    i;
+
+  if (++h->g_now > afl->g_max) { h->g_now = 0; }
+  w = (afl->w_init - afl->w_end) * (afl->g_max - h->g_now) / afl->g_max +
+      afl->w_end;
+
+  for (i = 0; i < RHAVOC_NUM; ++i) {
+    if (h->uses[i]) {
+      double eff = (double)h->score[i] / h->uses[i];
+      if (eff > h->eff_best[i]) {
+        h->eff_best[i] = eff;
+        h->L_best[i] = h->x[i];
+      }
+    }
+    h->score_total[i] += h->score[i];
+    total += h->score_total[i];
+  }
+
+  for (i = 0; i < RHAVOC_NUM; ++i) {
+    double g_best = total ? h->score_total[i] / total : h->x[i];
+    h->v[i] = w * h->v[i] + RAND_C * (h->L_best[i] - h->x[i]) +
+              RAND_C * (g_best - h->x[i]);
+    h->x[i] += h->v[i];
+    if (h->x[i] > RHAVOC_X_MAX) {
+      h->x[i] = RHAVOC_X_MAX;
+    } else if (h->x[i] < RHAVOC_X_MIN) {
+      h->x[i] = RHAVOC_X_MIN;
+    }
+    h->uses[i] = h->score[i] = 0;
+  }
+
+  havoc_reduce_norm(h);
+  h->execs = 0;
+}
+
+/**
+ * Score the operators the havoc exec just run was made of, by what
+ * has_few_bits said of it, and update the mix once per period.
+*/
+void havoc_reduce_account(afl_state_t *afl) {
+
+  struct havoc_reduce *h = afl->havoc_reduce;
+  u32 i, score = decrease_score(afl->last_few_bits);
+
+  for (i = 0; i < RHAVOC_NUM; ++i) {
+    if (!h->used[i]) { continue; }
+    h->used[i] = 0;
+    ++h->uses[i];
+    h->score[i] += score;
+  }
+
+  if (++h->execs >= IGORFUZZ_RHAVOC_PERIOD) { havoc_reduce_update(afl); }
+}
+
+/**
+ * The fitness MOpt gives an exec that found `finds` new entries, none
+ * if it found nothing. A lost edge counts IGORFUZZ_MOPT_BMS_WEIGHT, hit
+ * counts only by their log2, as a drop of thousands of hits is common
+ * and means far less.
+*/
+u64 mopt_find_weight(afl_state_t *afl, u64 finds, u32 bms, u64 cnts) {
+
+  if (!finds) { return 0; }
+
+  u64 w = finds + decrease_score(afl->last_few_bits);
+
+  if (bms != UINT32_MAX && afl->min_bitmap_size < bms)
+    w += (u64)(bms - afl->min_bitmap_size) * IGORFUZZ_MOPT_BMS_WEIGHT;
+
+  if (cnts != UINT64_MAX && afl->min_actual_cnts < cnts)
+    w += 64 - __builtin_clzll(cnts - afl->min_actual_cnts);
+
+  return w;
+}
+
+#endif // IGORFUZZ_FEATURE_ENABLE
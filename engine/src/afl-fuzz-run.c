@@ -394,6 +394,10 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
   s32 old_sc = afl->stage_cur, old_sm = afl->stage_max;
   u32 use_tmout = afl->fsrv.exec_tmout;
   u8 *old_sn = afl->stage_name;
+#if IGORFUZZ_FEATURE_ENABLE
+  u64 start_execs = afl->fsrv.total_execs;
+  u32 stable = 0;
+#endif
 
   if (unlikely(afl->shm.cmplog_mode)) { q->exec_cksum = 0; }
 
@@ -488,6 +492,11 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
 
   start_us = get_cur_time_us();
 
+#if IGORFUZZ_FEATURE_ENABLE
+  // The exec which found it counts as the first identical checksum
+  if (q->exec_cksum) { stable = 1; }
+#endif
+
   for (afl->stage_cur = 0; afl->stage_cur < afl->stage_max; ++afl->stage_cur) {
 
     if (unlikely(afl->debug)) {
@@ -523,6 +532,12 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
     if (unlikely(!q->bitsmap_size)) q->bitsmap_size = afl->bitsmap_size;
 #endif
 
+#if IGORFUZZ_FEATURE_ENABLE
+    // Raw hit counts of the matrix are the per-edge minimums to beat
+    if (unlikely(afl->afl_env.igorfuzz_edgehits && q == afl->testcase_matrix))
+      { seed_edge_hits(afl); }
+#endif
+
     classify_counts(&afl->fsrv);
     cksum = hash64(afl->fsrv.trace_bits, afl->fsrv.map_size, HASH_CONST);
     if (q->exec_cksum != cksum) {
@@ -541,6 +556,10 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
 
       if (q->exec_cksum) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+        // ignore the variable edges by setting them to fully discovered
+        mark_var_bytes(afl);
+#else
         u32 i;
 
         for (i = 0; i < afl->fsrv.map_size; ++i) {
@@ -555,6 +574,7 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
           }
 
         }
+#endif
 
         if (unlikely(!var_detected && !afl->afl_env.afl_no_warn_instability)) {
 
@@ -584,6 +604,15 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
 
     }
 
+#if IGORFUZZ_FEATURE_ENABLE
+    // Deterministic so far, only variance escalates to more cycles
+    if (afl->afl_env.igorfuzz_fastcal && !var_detected &&
+        q->exec_cksum == cksum && ++stable >= IGORFUZZ_FASTCAL_STABLE) {
+      afl->cal_execs_saved += afl->stage_max - afl->stage_cur - 1;
+      afl->stage_max = afl->stage_cur + 1;
+    }
+#endif
+
   }
 
   if (unlikely(afl->fixed_seed)) {
@@ -611,8 +640,14 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
 
   }
 
-  q->exec_us = diff_us / afl->stage_max;
-  q->bitmap_size = count_bytes(afl, afl->fsrv.trace_bits);
+  QUEUE_HOT_SET(afl, q, exec_us, diff_us / afl->stage_max);
+#if IGORFUZZ_FEATURE_ENABLE
+  // update_bitmap_score below walks the same list
+  QUEUE_HOT_SET(afl, q, bitmap_size, trace_nonzero(afl));
+  afl->trace_nz_fresh = 1;
+#else
+  QUEUE_HOT_SET(afl, q, bitmap_size, count_bytes(afl, afl->fsrv.trace_bits));
+#endif
   q->handicap = handicap;
   q->cal_failed = 0;
 
@@ -620,7 +655,14 @@ u8 calibrate_case(afl_state_t *afl, struct queue_entry *q, u8 *use_mem,
   ++afl->total_bitmap_entries;
 
 #if IGORFUZZ_FEATURE_ENABLE
+  q->actual_counts = afl->fsrv.actual_counts;
   if (new_bits > 0x10) {
+    if (afl->min_bitmap_size > q->bitmap_size ||
+        afl->min_actual_cnts > afl->fsrv.actual_counts) {
+      afl->last_decrease_time = get_cur_time();
+      afl->last_decrease_execs = afl->fsrv.total_execs;
+      afl->last_decrease_stamp = afl->last_decrease_time;
+    }
     if (afl->min_bitmap_size > q->bitmap_size)
         afl->min_bitmap_size = q->bitmap_size;
     if (afl->min_actual_cnts > afl->fsrv.actual_counts)
@@ -672,6 +714,10 @@ abort_calibration:
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  afl->cal_execs += afl->fsrv.total_execs - start_execs;
+#endif
+
   afl->stage_name = old_sn;
   afl->stage_cur = old_sc;
   afl->stage_max = old_sm;
@@ -1030,6 +1076,30 @@ u8 trim_case(afl_state_t *afl, struct queue_entry *q, u8 *in_buf) {
 
   if (needs_write) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+    // Entries in the queue store are appended again, even with no_unlink
+    if (unlikely(afl->no_unlink) && !q->store_buf) {
+
+      s32 fd = open(q->fname, O_WRONLY | O_CREAT | O_TRUNC, DEFAULT_PERMISSION);
+
+      if (fd < 0) { PFATAL("Unable to create '%s'", q->fname); }
+
+      u32 written = 0;
+      while (written < q->len) {
+
+        ssize_t result = write(fd, in_buf, q->len - written);
+        if (result > 0) written += result;
+
+      }
+
+      close(fd);
+
+    } else {
+
+      rewrite_queue_file(afl, q, in_buf, q->len);
+
+    }
+#else
     s32 fd;
 
     if (unlikely(afl->no_unlink)) {
@@ -1058,6 +1128,7 @@ u8 trim_case(afl_state_t *afl, struct queue_entry *q, u8 *in_buf) {
     }
 
     close(fd);
+#endif
 
     queue_testcase_retake_mem(afl, q, in_buf, q->len, orig_len);
 
@@ -1082,6 +1153,10 @@ common_fuzz_stuff(afl_state_t *afl, u8 *out_buf, u32 len) {
 
   u8 fault;
 
+#if IGORFUZZ_FEATURE_ENABLE
+  afl->last_few_bits = 0;  // an exec dropped below never gets judged
+#endif
+
   if (unlikely(len = write_to_testcase(afl, (void **)&out_buf, len, 0)) == 0) {
 
     return 0;
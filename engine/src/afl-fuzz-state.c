@@ -33,8 +33,9 @@ s16 interesting_16[] = {INTERESTING_8, INTERESTING_16};
 s32 interesting_32[] = {INTERESTING_8, INTERESTING_16, INTERESTING_32};
 
 char *power_names[POWER_SCHEDULES_NUM] = {"explore", "mmopt", "exploit",
-                                          "fast",    "coe",   "lin",
-                                          "quad",    "rare",  "seek"};
+                                          "decrease", "fast", "coe",
+                                          "lin",     "quad",  "rare",
+                                          "seek"};
 
 /* Initialize MOpt "globals" for this afl state */
 
@@ -144,6 +145,9 @@ void afl_state_init(afl_state_t *afl, uint32_t map_size) {
   afl->min_actual_cnts = UINT64_MAX;
   afl->min_bitmap_size = UINT32_MAX;
   afl->fsrv.actual_counts = 0;
+  afl->touched_words_stale = 1;
+  afl->crash_log_jsonl.fd = -1;
+  afl->crash_log_text.fd = -1;
 #endif
 
   init_mopt_globals(afl);
@@ -687,6 +691,17 @@ void afl_state_deinit(afl_state_t *afl) {
   afl_free(afl->ex_buf);
 
   ck_free(afl->virgin_bits);
+#if IGORFUZZ_FEATURE_ENABLE
+  ck_free(afl->touched_words);
+  ck_free(afl->trace_nz);
+  ck_free(afl->matrix_edges);
+  ck_free(afl->cull_edges);
+  ck_free(afl->cull_winners);
+  ck_free(afl->cull_snaps);
+  ck_free(afl->min_edge_hits);
+  ck_free(afl->ddmin_seen);
+  ck_free(afl->havoc_reduce);
+#endif
   ck_free(afl->virgin_tmout);
   ck_free(afl->virgin_crash);
   ck_free(afl->var_bytes);
@@ -196,6 +196,29 @@ void load_stats_file(afl_state_t *afl) {
 
 }
 
+#if IGORFUZZ_FEATURE_ENABLE
+/* IGORFUZZ_PLATEAU: neither min_bitmap_size nor min_actual_cnts dropped
+   for the given time and execs. Then the reduction has converged. */
+
+static void check_plateau(afl_state_t *afl, u64 cur_ms) {
+
+  u64 since = MAX(afl->last_decrease_time, afl->start_time);
+
+  if (cur_ms - since < afl->plateau_ms ||
+      afl->fsrv.total_execs - afl->last_decrease_execs < afl->plateau_execs)
+    return;
+
+  // A pool goes on with the PoCs not converged yet
+  if (afl->poc_pool) {
+    poc_pool_converged(afl);
+  } else {
+    afl->plateau_reached = 1;
+    afl->stop_soon = 2;
+  }
+
+}
+#endif
+
 /* Update stats file for unattended monitoring. */
 
 void write_stats_file(afl_state_t *afl, u32 t_bytes, double bitmap_cvg,
@@ -350,6 +373,85 @@ void write_stats_file(afl_state_t *afl, u32 t_bytes, double bitmap_cvg,
 
   /* ignore errors */
 
+#if IGORFUZZ_FEATURE_ENABLE
+  fprintf(f,
+          "sym_cache_entries : %u\n"
+          "sym_cache_hits    : %llu\n"
+          "sym_cache_misses  : %llu\n"
+          "min_bitmap_size   : %u\n"
+          "min_actual_cnts   : %llu\n",
+          afl->sym_cache_cnt, afl->sym_cache_hits, afl->sym_cache_misses,
+          afl->min_bitmap_size, afl->min_actual_cnts);
+
+  // seconds into the run, like the *_time fields consumers diff against
+  if (afl->last_decrease_stamp) {
+    fprintf(f, "last_decrease     : %llu\n",
+            (afl->last_decrease_stamp - afl->start_time) / 1000);
+  } else {
+    fprintf(f, "last_decrease     : none\n");
+  }
+
+  fprintf(f,
+          "execs_since_dec   : %llu\n"
+          "plateau_reached   : %u\n"
+          "corpus_dominated  : %u\n"
+          "cal_execs         : %llu\n"
+          "cal_execs_saved   : %llu\n"
+          "cal_overhead      : %0.02f%%\n"
+          "testcache_hits    : %llu\n"
+          "testcache_misses  : %llu\n"
+          "queue_collected   : %u\n"
+          "queue_gc_bytes    : %llu\n"
+          "influence_finds   : %llu\n"
+          "influence_execs   : %llu\n"
+          "ddmin_finds       : %llu\n"
+          "ddmin_execs       : %llu\n"
+          "ddmin_cache_hits  : %llu\n",
+          afl->fsrv.total_execs - afl->last_decrease_execs,
+          afl->plateau_reached, afl->queued_dominated,
+          afl->cal_execs, afl->cal_execs_saved,
+          afl->fsrv.total_execs
+              ? ((double)afl->cal_execs * 100) / afl->fsrv.total_execs
+              : 0,
+          afl->q_testcase_hits, afl->q_testcase_misses,
+          afl->queued_collected, afl->queue_gc_bytes,
+          afl->stage_finds[STAGE_INFLUENCE],
+          afl->stage_cycles[STAGE_INFLUENCE],
+          afl->stage_finds[STAGE_DDMIN], afl->stage_cycles[STAGE_DDMIN],
+          afl->ddmin_cache_hits);
+
+  /* MOpt's weighted finds per 1k execs of each operator, as pso_updating
+     sees them: the core module and the swarm the pilot is on. */
+  if (afl->limit_time_sig) {
+
+    u32 i;
+    fprintf(f, "mopt_core_eff     :");
+    for (i = 0; i < operator_num; i++) {
+
+      u64 c = afl->core_operator_cycles_puppet_v2[i];
+      fprintf(f, " %0.02f",
+              c ? (double)afl->core_operator_finds_puppet_v2[i] * 1000 / c
+                : 0);
+
+    }
+
+    fprintf(f, "\nmopt_pilot_eff    :");
+    for (i = 0; i < operator_num; i++) {
+
+      u64 c = afl->stage_cycles_puppet_v2[afl->swarm_now][i];
+      fprintf(f, " %0.02f",
+              c ? (double)afl->stage_finds_puppet_v2[afl->swarm_now][i] *
+                      1000 / c
+                : 0);
+
+    }
+
+    fprintf(f, "\n");
+
+  }
+
+#endif
+
   if (afl->debug) {
 
     u32 i = 0;
@@ -636,6 +738,10 @@ void show_stats_normal(afl_state_t *afl) {
                      afl->stats_avg_exec);
     save_auto(afl);
     write_bitmap(afl);
+#if IGORFUZZ_FEATURE_ENABLE
+    if (afl->crash_mode) { sym_cache_save(afl); }
+    crash_log_flush(afl);
+#endif
 
   }
 
@@ -698,6 +804,10 @@ void show_stats_normal(afl_state_t *afl) {
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (unlikely(afl->afl_env.igorfuzz_plateau)) { check_plateau(afl, cur_ms); }
+#endif
+
   if (unlikely(afl->total_crashes && afl->afl_env.afl_bench_until_crash)) {
 
     afl->stop_soon = 2;
@@ -1457,6 +1567,10 @@ void show_stats_pizza(afl_state_t *afl) {
                      afl->stats_avg_exec);
     save_auto(afl);
     write_bitmap(afl);
+#if IGORFUZZ_FEATURE_ENABLE
+    if (afl->crash_mode) { sym_cache_save(afl); }
+    crash_log_flush(afl);
+#endif
 
   }
 
@@ -1523,6 +1637,10 @@ void show_stats_pizza(afl_state_t *afl) {
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (unlikely(afl->afl_env.igorfuzz_plateau)) { check_plateau(afl, cur_ms); }
+#endif
+
   if (unlikely(afl->total_crashes && afl->afl_env.afl_bench_until_crash)) {
 
     afl->stop_soon = 2;
@@ -0,0 +1,288 @@
+/*
+   IgorFuzz - append-only queue store
+   ----------------------------------
+
+   With IGORFUZZ_STORE, the entries queued during a run are not written
+   one file each to <out_dir>/queue/, which costs a create, a write and
+   a close per entry and, when reading them back for splicing, an open,
+   a read and a close per use. They are appended to one data file,
+   <out_dir>/queue.store, which stays mapped read-only, so a testcase
+   is served to the mutator straight from the mapping. Trimming appends
+   the trimmed version as a new record; nothing is ever rewritten.
+
+   Each record gets a line "<offset> <length> <name>" in the index
+   <out_dir>/queue.idx, and the last line for a name is its current
+   version. Names are relative to queue/: an entry IGORFUZZ_PARETO_MOVE
+   put aside gets its record listed again as .state/dominated/<name>,
+   which stands for the file moving there. The input seeds stay plain
+   files under queue/.
+
+   At the end of a run the store is exported: every entry is written
+   to the file its name says, so queue/ looks the same as without the
+   store to everything that reads it afterwards. Entries freed by
+   IGORFUZZ_QUEUE_GC are written out before that, when they go. A run
+   that was killed can be exported with
+   utils/queue_store/export-queue-store.sh; resuming it in place does
+   the same first, and the resumed run starts a store of its own.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include "afl-fuzz.h"
+
+#if IGORFUZZ_FEATURE_ENABLE
+
+#include <sys/mman.h>
+
+/* Address space for the data file, it can't grow past it. Every PoC
+   of a pool maps a store of its own, so they split the reserve. */
+static u64 queue_store_reserve(afl_state_t *afl) {
+  u64 all = sizeof(void *) > 4 ? IGORFUZZ_STORE_RESERVE : (1ULL << 30);
+  return MAX(all / poc_pool_size(afl), MIN(all, IGORFUZZ_STORE_RESERVE_MIN));
+}
+
+/* Open the store of out_dir. It always starts empty: handle_existing_out_dir
+   removed the files of the last run, after queue_store_recover wrote
+   them to queue/ for an in-place resume. */
+static void queue_store_open(afl_state_t *afl) {
+  struct queue_store *st = &afl->queue_store;
+  struct stat sb;
+  u8 *fn;
+
+  fn = alloc_printf("%s/" IGORFUZZ_STORE_DATA, afl->out_dir);
+  st->data_fd = open(fn, O_RDWR | O_CREAT | O_APPEND, DEFAULT_PERMISSION);
+  if (st->data_fd < 0) { PFATAL("Unable to create '%s'", fn); }
+  if (fstat(st->data_fd, &sb)) { PFATAL("Unable to stat '%s'", fn); }
+  ck_free(fn);
+
+  fn = alloc_printf("%s/" IGORFUZZ_STORE_INDEX, afl->out_dir);
+  st->idx_fd = open(fn, O_WRONLY | O_CREAT | O_APPEND, DEFAULT_PERMISSION);
+  if (st->idx_fd < 0) { PFATAL("Unable to create '%s'", fn); }
+  ck_free(fn);
+
+  // Pages past the end of the file only become readable once appended to
+  st->reserve = queue_store_reserve(afl);
+  st->map = mmap(NULL, st->reserve, PROT_READ, MAP_SHARED | MAP_NORESERVE,
+                 st->data_fd, 0);
+  if (st->map == MAP_FAILED)
+    PFATAL("Unable to map the queue store (%llu bytes)", st->reserve);
+  st->size = sb.st_size;
+}
+
+/* The name of fn in the index, relative to queue/ */
+static u8 *queue_store_name(afl_state_t *afl, u8 *fn) {
+  u32 dir = strlen(afl->out_dir);
+  u8 *name;
+
+  if (!strncmp(fn, afl->out_dir, dir) && !strncmp(fn + dir, "/queue/", 7))
+    return fn + dir + 7;
+
+  name = strrchr(fn, '/');
+  return name ? name + 1 : fn;
+}
+
+/* List the record at off in the index under the name of fn */
+static void queue_store_list(afl_state_t *afl, u64 off, u32 len, u8 *fn) {
+  u8 *line = alloc_printf("%llu %u %s\n", off, len, queue_store_name(afl, fn));
+  ck_write(afl->queue_store.idx_fd, line, strlen(line), IGORFUZZ_STORE_INDEX);
+  ck_free(line);
+}
+
+/* Append a record, and its line to the index. Returns it in the map. */
+static u8 *queue_store_append(afl_state_t *afl, u8 *fn, u8 *mem, u32 len) {
+  struct queue_store *st = &afl->queue_store;
+  u8 *rec;
+
+  if (unlikely(!st->map)) { queue_store_open(afl); }
+
+  if (unlikely(st->size + len > st->reserve))
+    FATAL("The queue store is full (%llu bytes)", st->reserve);
+
+  ck_write(st->data_fd, mem, len, IGORFUZZ_STORE_DATA);
+  rec = st->map + st->size;
+
+  queue_store_list(afl, st->size, len, fn);
+
+  st->size += len;
+  return rec;
+}
+
+/**
+ * Write a new queue entry, before add_to_queue is called with fn.
+ * In the store, add_to_queue then takes the record over.
+*/
+void write_queue_file(afl_state_t *afl, u8 *fn, u8 *mem, u32 len) {
+  if (afl->afl_env.igorfuzz_store) {
+    afl->queue_store.last = queue_store_append(afl, fn, mem, len);
+    afl->queue_store.last_fn = fn;
+    return;
+  }
+
+  s32 fd = open(fn, O_WRONLY | O_CREAT | O_EXCL, DEFAULT_PERMISSION);
+  if (unlikely(fd < 0)) { PFATAL("Unable to create '%s'", fn); }
+  ck_write(fd, mem, len, fn);
+  close(fd);
+}
+
+/**
+ * Replace the testcase of q, after a trim. Entries in the store get
+ * a new record, the files of the others are written over.
+*/
+void rewrite_queue_file(afl_state_t *afl, struct queue_entry *q, u8 *mem,
+                        u32 len) {
+  if (q->store_buf) {
+    q->store_buf = queue_store_append(afl, q->fname, mem, len);
+    return;
+  }
+
+  unlink(q->fname);                                      /* ignore errors */
+  s32 fd = open(q->fname, O_WRONLY | O_CREAT | O_EXCL, DEFAULT_PERMISSION);
+  if (unlikely(fd < 0)) { PFATAL("Unable to create '%s'", q->fname); }
+  ck_write(fd, mem, len, q->fname);
+  close(fd);
+}
+
+/**
+ * q, an entry in the store, got renamed to fn. Its file doesn't exist
+ * yet, so list its record under the new name for the export.
+*/
+void queue_store_move(afl_state_t *afl, struct queue_entry *q, u8 *fn) {
+  queue_store_list(afl, q->store_buf - afl->queue_store.map, q->len, fn);
+}
+
+/* The record write_queue_file just appended for fname, if any */
+u8 *queue_store_claim(afl_state_t *afl, u8 *fname) {
+  struct queue_store *st = &afl->queue_store;
+  u8 *rec = NULL;
+
+  if (st->last_fn == fname) { rec = st->last; }
+  st->last_fn = st->last = NULL;
+  return rec;
+}
+
+/* Write q to its file, unless it is there. Returns whether it wasn't. */
+static u8 queue_store_write_out(struct queue_entry *q) {
+  s32 fd = open(q->fname, O_WRONLY | O_CREAT | O_EXCL, DEFAULT_PERMISSION);
+  if (fd < 0) {
+    if (errno == EEXIST) { return 0; }
+    PFATAL("Unable to create '%s'", q->fname);
+  }
+  ck_write(fd, q->store_buf, q->len, q->fname);
+  close(fd);
+  return 1;
+}
+
+/**
+ * Write every entry in the store to its file, as the run would
+ * have without the store. Files already there are left alone.
+*/
+void queue_store_export(afl_state_t *afl) {
+  u32 exported = 0;
+
+  for (u32 i = 0; i < afl->queued_items; ++i) {
+    struct queue_entry *q = afl->queue_buf[i];
+    if (q->store_buf) { exported += queue_store_write_out(q); }
+  }
+
+  if (exported) { OKF("Exported %u entries of the queue store.", exported); }
+}
+
+/* An entry about to be freed gets its file now, the export won't see it */
+void queue_store_evict(struct queue_entry *q) {
+  if (!q->store_buf) { return; }
+  queue_store_write_out(q);
+  q->store_buf = NULL;
+}
+
+/* Unmap the store, the queue must not be read from it anymore */
+void queue_store_close(afl_state_t *afl) {
+  struct queue_store *st = &afl->queue_store;
+  if (!st->map) { return; }
+
+  munmap(st->map, st->reserve);
+  close(st->data_fd);
+  close(st->idx_fd);
+  memset(st, 0, sizeof(struct queue_store));
+
+  for (u32 i = 0; i < afl->queued_items; ++i) {
+    afl->queue_buf[i]->store_buf = NULL;
+  }
+}
+
+/**
+ * An in-place resume reads dir, the queue/ of the run before, which
+ * lacks the entries left in its store. Write each record to the file
+ * its name says, relative to dir, in index order so the last version
+ * of a name wins, as export-queue-store.sh does. The caller removes
+ * the store afterwards.
+*/
+void queue_store_recover(afl_state_t *afl, u8 *dir) {
+  u8 *fn = alloc_printf("%s/" IGORFUZZ_STORE_INDEX, afl->out_dir);
+  FILE *idx = fopen(fn, "r");
+  ck_free(fn);
+  if (!idx) { return; }
+
+  fn = alloc_printf("%s/" IGORFUZZ_STORE_DATA, afl->out_dir);
+  s32 data_fd = open(fn, O_RDONLY);
+  if (data_fd < 0) { PFATAL("Unable to open '%s'", fn); }
+  ck_free(fn);
+
+  if (mkdir(dir, 0700) && errno != EEXIST) { PFATAL("Unable to create '%s'", dir); }
+
+  u8  line[PATH_MAX + 64], *buf = NULL;
+  u32 cnt = 0;
+
+  while (fgets(line, sizeof(line), idx)) {
+    u64 off;
+    u32 len;
+    s32 at = 0;
+    u8 *name, *end = strchr(line, '\n');
+
+    // The last line is cut short if the run got killed writing it
+    if (!end || sscanf(line, "%llu %u %n", &off, &len, &at) != 2 || !at)
+      continue;
+    *end = 0;
+    name = line + at;
+
+    buf = ck_realloc(buf, MAX(len, 1U));
+    if (pread(data_fd, buf, len, off) != (ssize_t)len) {
+      WARNF("Record of '%s' is past the end of the queue store", name);
+      continue;
+    }
+
+    // One with a directory was moved there from dir
+    u8 *base = strrchr(name, '/');
+    if (base) {
+      for (u8 *p = strchr(name, '/'); p; p = strchr(p + 1, '/')) {
+        *p = 0;
+        fn = alloc_printf("%s/%s", dir, name);
+        if (mkdir(fn, 0700) && errno != EEXIST) { PFATAL("Unable to create '%s'", fn); }
+        ck_free(fn);
+        *p = '/';
+      }
+      fn = alloc_printf("%s/%s", dir, base + 1);
+      unlink(fn);                                        /* ignore errors */
+      ck_free(fn);
+    }
+
+    fn = alloc_printf("%s/%s", dir, name);
+    s32 fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, DEFAULT_PERMISSION);
+    if (fd < 0) { PFATAL("Unable to create '%s'", fn); }
+    ck_write(fd, buf, len, fn);
+    close(fd);
+    ck_free(fn);
+    ++cnt;
+  }
+
+  ck_free(buf);
+  close(data_fd);
+  fclose(idx);
+  if (cnt) { OKF("Recovered %u records of the queue store.", cnt); }
+}
+
+#endif // IGORFUZZ_FEATURE_ENABLE
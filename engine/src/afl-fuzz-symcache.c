@@ -0,0 +1,432 @@
+/*
+   IgorFuzz - symbol cache for crash site analysis
+   -----------------------------------------------
+
+   find_crash_site needs the function name of nearly every stack frame
+   of every crash, but a reduction run keeps hitting the same few dozen
+   addresses. Here we remember (module, offset) -> (function, verdict)
+   so the symbolizer is only asked once per address. The cache is saved
+   in the output directory, where resumed runs and the other instances
+   of the same sync directory pick it up.
+
+   For IGORFUZZ_LAZYSYM we also keep, per module, the address ranges of
+   blacklisted functions taken from its ELF symbol table. Then frames
+   can be judged by raw address and the symbolizer is only needed when
+   the name of the crash site is actually reported.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include "afl-fuzz.h"
+
+#if IGORFUZZ_FEATURE_ENABLE
+
+#include <elf.h>
+#include "sym-blacklist.inc"
+
+#define SYM_CACHE_FILE    ".sym_cache"
+#define SYM_CACHE_HEADER  "# IgorFuzz symbol cache v1\n"
+#define SYM_CACHE_INIT_SZ 1024
+
+/* Identity of a module on disk. Entries of a rebuilt module get dropped. */
+static u64 sym_cache_stamp(u8 *module) {
+  struct stat st;
+  if (stat(module, &st)) { return 0; }
+  return ((u64)st.st_mtime << 32) ^ (u64)st.st_size;
+}
+
+static inline u64 sym_cache_hash(u8 *module, u32 offset) {
+  u64 h = hash64(module, strlen(module), HASH_CONST) ^
+          ((u64)offset * 0x9E3779B97F4A7C15ULL);
+  return h ? h : 1; //0 marks an empty slot
+}
+
+static struct sym_cache_entry *
+sym_cache_slot(struct sym_cache_entry *table, u32 size, u64 hash,
+  u8 *module, u32 offset) {
+  u32 i = (u32)hash & (size - 1);
+  while (table[i].hash) {
+    if (table[i].hash == hash && table[i].offset == offset &&
+        !strcmp(table[i].module, module))
+      break;
+    i = (i + 1) & (size - 1);
+  }
+  return &table[i];
+}
+
+static void sym_cache_grow(afl_state_t *afl) {
+  u32 new_size = afl->sym_cache_size ? afl->sym_cache_size << 1 : SYM_CACHE_INIT_SZ;
+  struct sym_cache_entry *new_table = ck_alloc(new_size * sizeof(struct sym_cache_entry));
+
+  for (u32 i = 0; i < afl->sym_cache_size; ++i) {
+    struct sym_cache_entry *e = &afl->sym_cache[i];
+    if (!e->hash) { continue; }
+    *sym_cache_slot(new_table, new_size, e->hash, e->module, e->offset) = *e;
+  }
+
+  ck_free(afl->sym_cache);
+  afl->sym_cache = new_table;
+  afl->sym_cache_size = new_size;
+}
+
+/**
+ * Look up a stack frame in the symbol cache.
+ * @return NULL if never symbolized before.
+*/
+struct sym_cache_entry * __attribute__((hot))
+sym_cache_find(afl_state_t *afl, u8 *module, u32 offset) {
+  if (unlikely(!afl->sym_cache_cnt)) { ++afl->sym_cache_misses; return NULL; }
+
+  struct sym_cache_entry *e = sym_cache_slot(afl->sym_cache,
+    afl->sym_cache_size, sym_cache_hash(module, offset), module, offset);
+
+  if (unlikely(!e->hash)) { ++afl->sym_cache_misses; return NULL; }
+  ++afl->sym_cache_hits;
+  return e;
+}
+
+static struct sym_cache_entry *
+sym_cache_insert(afl_state_t *afl, u8 *module, u32 offset,
+  u8 verdict, u8 *func, u64 stamp) {
+  if (unlikely((afl->sym_cache_cnt + 1) * 2 > afl->sym_cache_size))
+    sym_cache_grow(afl);
+
+  u64 hash = sym_cache_hash(module, offset);
+  struct sym_cache_entry *e = sym_cache_slot(afl->sym_cache,
+    afl->sym_cache_size, hash, module, offset);
+  if (e->hash) { return e; } //already known
+
+  e->hash    = hash;
+  e->module  = ck_strdup(module);
+  e->func    = func ? ck_strdup(func) : NULL;
+  e->offset  = offset;
+  e->verdict = verdict;
+  e->stamp   = stamp;
+  ++afl->sym_cache_cnt;
+  afl->sym_cache_dirty = 1;
+  return e;
+}
+
+/**
+ * Remember the result of symbolizing a stack frame.
+ * @param func May be NULL if it can't be symbolized.
+*/
+struct sym_cache_entry *
+sym_cache_add(afl_state_t *afl, u8 *module, u32 offset, u8 verdict, u8 *func) {
+  return sym_cache_insert(afl, module, offset, verdict, func,
+    sym_cache_stamp(module));
+}
+
+/* Merge one cache file. Entries for modules changed since are skipped. */
+static void sym_cache_load_file(afl_state_t *afl, u8 *fn) {
+  FILE *f = fopen(fn, "r");
+  if (!f) { return; }
+
+  char *line_buf = ck_alloc_nozero(IGORFUZZ_CALLSTACK_MAX_LINELEN);
+  u8   *last_module = NULL;
+  u64   last_stamp = 0;
+
+  if (!fgets(line_buf, IGORFUZZ_CALLSTACK_MAX_LINELEN, f) ||
+      strcmp(line_buf, SYM_CACHE_HEADER)) { goto done; }
+
+  // verdict \t offset \t stamp \t module \t func \n
+  while (fgets(line_buf, IGORFUZZ_CALLSTACK_MAX_LINELEN, f)) {
+    char *field[5], *p = line_buf;
+    u32   n = 0;
+
+    size_t len_ = strlen(line_buf);
+    if (unlikely(!len_ || line_buf[len_ - 1] != '\n')) { continue; }
+    line_buf[len_ - 1] = '\0';
+
+    while (n < 5) {
+      field[n++] = p;
+      p = strchr(p, '\t');
+      if (!p) { break; }
+      *p++ = '\0';
+    }
+    if (n != 5 || p) { continue; } //corrupted
+
+    u8  verdict = (u8)strtoul(field[0], NULL, 10);
+    u32 offset  = (u32)strtoul(field[1], NULL, 16);
+    u64 stamp   = strtoull(field[2], NULL, 16);
+    if (verdict > SYM_FRAME_ALLOWED || !field[3][0]) { continue; }
+
+    if (!last_module || strcmp(last_module, field[3])) {
+      ck_free(last_module);
+      last_module = ck_strdup(field[3]);
+      last_stamp  = sym_cache_stamp(last_module);
+    }
+    if (!stamp || stamp != last_stamp) { continue; } //stale
+
+    sym_cache_insert(afl, field[3], offset, verdict,
+      field[4][0] ? (u8 *)field[4] : NULL, stamp);
+  }
+
+done:
+  ck_free(last_module);
+  ck_free(line_buf);
+  fclose(f);
+}
+
+/**
+ * Load the symbol cache of the output directory, as well as
+ * those of the other instances sharing the sync directory.
+*/
+void sym_cache_load(afl_state_t *afl) {
+  u8 *fn = alloc_printf("%s/" SYM_CACHE_FILE, afl->root_out_dir);
+  sym_cache_load_file(afl, fn);
+  ck_free(fn);
+
+  if (afl->sync_id && afl->sync_dir) {
+    DIR *sd = opendir(afl->sync_dir);
+    if (sd) {
+      struct dirent *sd_ent;
+      while ((sd_ent = readdir(sd))) {
+        if (sd_ent->d_name[0] == '.' || !strcmp(afl->sync_id, sd_ent->d_name))
+          { continue; }
+        fn = alloc_printf("%s/%s/" SYM_CACHE_FILE, afl->sync_dir, sd_ent->d_name);
+        sym_cache_load_file(afl, fn);
+        ck_free(fn);
+      }
+      closedir(sd);
+    }
+  }
+
+  // What we loaded is already on disk somewhere
+  afl->sym_cache_dirty = 0;
+  if (afl->sym_cache_cnt)
+    OKF("Loaded %u cached symbols", afl->sym_cache_cnt);
+}
+
+/**
+ * Save the symbol cache if anything new was symbolized.
+ * The file is replaced atomically for the sake of other instances.
+*/
+void sym_cache_save(afl_state_t *afl) {
+  if (!afl->sym_cache_dirty) { return; }
+  afl->sym_cache_dirty = 0;
+
+  u8 *fn = alloc_printf("%s/" SYM_CACHE_FILE, afl->root_out_dir);
+  u8 *tmp = alloc_printf("%s/" SYM_CACHE_FILE ".tmp", afl->root_out_dir);
+
+  s32 fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, DEFAULT_PERMISSION);
+  if (fd < 0) { PFATAL("Unable to create '%s'", tmp); }
+  FILE *f = fdopen(fd, "w");
+  if (!f) { PFATAL("fdopen() failed"); }
+
+  fputs(SYM_CACHE_HEADER, f);
+  for (u32 i = 0; i < afl->sym_cache_size; ++i) {
+    struct sym_cache_entry *e = &afl->sym_cache[i];
+    if (!e->hash) { continue; }
+    fprintf(f, "%u\t%x\t%llx\t%s\t%s\n", e->verdict, e->offset, e->stamp,
+      e->module, e->func ? e->func : (u8 *)"");
+  }
+
+  fclose(f);
+  if (rename(tmp, fn)) { PFATAL("Unable to rename '%s'", tmp); }
+
+  ck_free(tmp);
+  ck_free(fn);
+}
+
+void sym_cache_destroy(afl_state_t *afl) {
+  for (u32 i = 0; i < afl->sym_cache_size; ++i) {
+    ck_free(afl->sym_cache[i].module);
+    ck_free(afl->sym_cache[i].func);
+  }
+  ck_free(afl->sym_cache);
+  afl->sym_cache = NULL;
+  afl->sym_cache_size = afl->sym_cache_cnt = 0;
+
+  for (u32 i = 0; i < afl->sym_modules_cnt; ++i) {
+    ck_free(afl->sym_modules[i]->path);
+    ck_free(afl->sym_modules[i]->ranges);
+    ck_free(afl->sym_modules[i]->funcs);
+    ck_free(afl->sym_modules[i]);
+  }
+  ck_free(afl->sym_modules);
+  afl->sym_modules = NULL;
+  afl->sym_module_last = NULL;
+  afl->sym_modules_cnt = 0;
+}
+
+static u8 sym_blacklisted_function(const char *func) {
+  for (int i=0; sym_blacklist_function[i] != NULL; ++i) {
+    if (strstr(func, sym_blacklist_function[i])) { return 1; }
+  }
+  return 0;
+}
+
+static int compare_sym_range(const void *a, const void *b) {
+  const u64 *ra = a, *rb = b;
+  return ra[0] < rb[0] ? -1 : (ra[0] > rb[0] ? 1 : 0);
+}
+
+/* Append [start, end) to a range list */
+static void sym_range_add(u64 (**r)[2], u32 *n, u64 start, u64 end) {
+  *r = ck_realloc(*r, (*n + 1) * sizeof(u64[2]));
+  (*r)[*n][0] = start;
+  (*r)[*n][1] = end;
+  ++*n;
+}
+
+/* Collect [start, end) of all functions, and of blacklisted ones apart,
+   from the .symtab of an ELF image, or .dynsym if it has been stripped.
+   Returns 0 on failure. */
+#define SYM_COLLECT_RANGES(NAME, Ehdr, Shdr, Sym, ST_TYPE)                     \
+  static u8 NAME(struct sym_module *m, u8 *img, size_t img_len) {              \
+    Ehdr *eh = (Ehdr *)img;                                                    \
+    if (eh->e_shoff + (u64)eh->e_shnum * sizeof(Shdr) > img_len) return 0;     \
+    Shdr *sh = (Shdr *)(img + eh->e_shoff), *tab = NULL;                       \
+    for (u32 i = 0; i < eh->e_shnum; ++i) {                                    \
+      if (sh[i].sh_type == SHT_SYMTAB) { tab = &sh[i]; break; }                \
+      if (sh[i].sh_type == SHT_DYNSYM) { tab = &sh[i]; }                       \
+    }                                                                          \
+    if (!tab || tab->sh_link >= eh->e_shnum) return 0;                         \
+    Shdr *str = &sh[tab->sh_link];                                             \
+    if (tab->sh_offset + tab->sh_size > img_len ||                             \
+        str->sh_offset + str->sh_size > img_len) return 0;                     \
+    Sym  *sym = (Sym *)(img + tab->sh_offset);                                 \
+    char *names = (char *)(img + str->sh_offset);                              \
+    u32   n_sym = tab->sh_size / sizeof(Sym);                                  \
+    for (u32 i = 0; i < n_sym; ++i) {                                          \
+      u8 type = ST_TYPE(sym[i].st_info);                                       \
+      if ((type != STT_FUNC && type != STT_GNU_IFUNC) || !sym[i].st_size ||    \
+          sym[i].st_shndx == SHN_UNDEF || sym[i].st_name >= str->sh_size)      \
+        continue;                                                              \
+      if (!memchr(names + sym[i].st_name, 0, str->sh_size - sym[i].st_name))   \
+        continue;                                                              \
+      u64 end = sym[i].st_value + sym[i].st_size;                              \
+      sym_range_add(&m->funcs, &m->n_funcs, sym[i].st_value, end);             \
+      if (sym_blacklisted_function(names + sym[i].st_name))                    \
+        sym_range_add(&m->ranges, &m->n_ranges, sym[i].st_value, end);         \
+    }                                                                          \
+    return 1;                                                                  \
+  }
+
+SYM_COLLECT_RANGES(sym_collect_ranges64, Elf64_Ehdr, Elf64_Shdr, Elf64_Sym, ELF64_ST_TYPE)
+SYM_COLLECT_RANGES(sym_collect_ranges32, Elf32_Ehdr, Elf32_Shdr, Elf32_Sym, ELF32_ST_TYPE)
+
+#undef SYM_COLLECT_RANGES
+
+/* Sort and merge overlapping ranges, e.g. aliases. Returns their count. */
+static u32 sym_ranges_merge(u64 (*r)[2], u32 cnt) {
+  if (!cnt) { return 0; }
+  qsort(r, cnt, sizeof(u64[2]), compare_sym_range);
+
+  u32 n = 0;
+  for (u32 i = 1; i < cnt; ++i) {
+    if (r[i][0] <= r[n][1]) {
+      if (r[i][1] > r[n][1]) r[n][1] = r[i][1];
+    } else {
+      ++n;
+      r[n][0] = r[i][0];
+      r[n][1] = r[i][1];
+    }
+  }
+  return n + 1;
+}
+
+/* Read function ranges of a module, sorted and merged. */
+static void sym_module_load_ranges(struct sym_module *m) {
+  s32 fd = open(m->path, O_RDONLY);
+  if (fd < 0) { return; }
+
+  struct stat st;
+  if (fstat(fd, &st) || (size_t)st.st_size < sizeof(Elf64_Ehdr)) { close(fd); return; }
+
+  u8 *img = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (img == MAP_FAILED) { return; }
+
+  if (!memcmp(img, ELFMAG, SELFMAG)) {
+    if (img[EI_CLASS] == ELFCLASS64)
+      m->has_symtab = sym_collect_ranges64(m, img, st.st_size);
+    else if (img[EI_CLASS] == ELFCLASS32)
+      m->has_symtab = sym_collect_ranges32(m, img, st.st_size);
+  }
+  munmap(img, st.st_size);
+
+  m->n_ranges = sym_ranges_merge(m->ranges, m->n_ranges);
+  m->n_funcs = sym_ranges_merge(m->funcs, m->n_funcs);
+}
+
+/**
+ * Get what we know about a module of the call stack.
+ * Modules are looked into only once, when first met.
+*/
+struct sym_module * __attribute__((hot))
+sym_module_get(afl_state_t *afl, u8 *path) {
+  // Frames of the same module usually come in a row
+  if (likely(afl->sym_module_last &&
+             !strcmp(afl->sym_module_last->path, path)))
+    return afl->sym_module_last;
+
+  for (u32 i = 0; i < afl->sym_modules_cnt; ++i) {
+    if (!strcmp(afl->sym_modules[i]->path, path))
+      return (afl->sym_module_last = afl->sym_modules[i]);
+  }
+
+  struct sym_module *m = ck_alloc(sizeof(struct sym_module));
+  m->path = ck_strdup(path);
+
+  u8 *module_name = strrchr(path, '/');
+  if (unlikely(!module_name)) module_name = path;
+  //stack frame on a blocked module and the frames
+  //on the top of it all shouldn't be crash site.
+#if IGORFUZZ_CALLSTACK_EXACT_MODULE
+  u8 *module_this = strrchr(afl->fsrv.target_path, '/');
+  if (unlikely(!module_this)) module_this = afl->fsrv.target_path;
+  if (strcmp(module_this, module_name))
+    m->blocked = 1;
+#else
+  for (int i=0; sym_blacklist_module[i] != NULL; ++i) {
+    if (strstr(module_name, sym_blacklist_module[i]))
+      { m->blocked = 1; break; }
+  }
+#endif
+
+  if (!m->blocked && afl->afl_env.igorfuzz_lazysym)
+    sym_module_load_ranges(m);
+
+  afl->sym_modules = ck_realloc(afl->sym_modules,
+    (afl->sym_modules_cnt + 1) * sizeof(struct sym_module *));
+  afl->sym_modules[afl->sym_modules_cnt++] = m;
+  return (afl->sym_module_last = m);
+}
+
+/**
+ * Check by raw address if a frame is inside a blacklisted function.
+ * Only meaningful if m->has_symtab.
+*/
+static inline u8 sym_ranges_find(u64 (*r)[2], u32 n, u32 offset) {
+  u32 lo = 0, hi = n;
+  while (lo < hi) { //find the last range starting at or before offset
+    u32 mid = (lo + hi) >> 1;
+    if (r[mid][0] <= offset) lo = mid + 1; else hi = mid;
+  }
+  return lo && offset < r[lo - 1][1];
+}
+
+u8 __attribute__((hot))
+sym_module_blocked_addr(struct sym_module *m, u32 offset) {
+  return sym_ranges_find(m->ranges, m->n_ranges, offset);
+}
+
+/**
+ * Check by raw address if a frame is inside any function of the symtab.
+ * Frames outside all of them are left to the symbolizer, as without
+ * IGORFUZZ_LAZYSYM. Only meaningful if m->has_symtab.
+*/
+u8 __attribute__((hot))
+sym_module_func_addr(struct sym_module *m, u32 offset) {
+  return sym_ranges_find(m->funcs, m->n_funcs, offset);
+}
+
+#endif // IGORFUZZ_FEATURE_ENABLE
+
@@ -135,7 +135,7 @@ static void usage(u8 *argv0, int more_help) {
       "  -p schedule   - power schedules compute a seed's performance score:\n"
       "                  fast(default), explore, exploit, seek, rare, mmopt, "
       "coe, lin\n"
-      "                  quad -- see docs/FAQ.md for more information\n"
+      "                  quad, decrease -- see docs/FAQ.md for more information\n"
       "  -f file       - location read by the fuzzed program (default: stdin "
       "or @@)\n"
       "  -t msec       - timeout for each run (auto-scaled, default %u ms). "
@@ -445,6 +445,9 @@ int main(int argc, char **argv_orig, char **envp) {
 
   s32 opt, auto_sync = 0 /*, user_set_cache = 0*/;
   u64 prev_queued = 0;
+#if IGORFUZZ_FEATURE_ENABLE
+  s32 exit_code = 0;
+#endif
   u32 sync_interval_cnt = 0, seek_to = 0, show_help = 0, default_output = 1,
       map_size = get_map_size();
   u8 *extras_dir[4];
@@ -486,6 +489,58 @@ int main(int argc, char **argv_orig, char **envp) {
     get_afl_env(IGORFUZZ_CALLSTACK_ENV_SHUTDOWN) ? 1 : 0;
   afl->afl_env.igorfuzz_toolpath = 
     (u8 *)get_afl_env(IGORFUZZ_CALLSTACK_ENV_TOOLPATH);
+  afl->afl_env.igorfuzz_lazysym = 
+    get_afl_env(IGORFUZZ_CALLSTACK_ENV_LAZYSYM) ? 1 : 0;
+  afl->afl_env.igorfuzz_edgehits = 
+    get_afl_env(IGORFUZZ_ENV_EDGEHITS) ? 1 : 0;
+  afl->afl_env.igorfuzz_crashtxt = 
+    get_afl_env(IGORFUZZ_ENV_CRASHTXT) ? 1 : 0;
+  afl->afl_env.igorfuzz_plateau = 
+    (u8 *)get_afl_env(IGORFUZZ_ENV_PLATEAU);
+  if (afl->afl_env.igorfuzz_plateau) {
+    unsigned long long secs = 0, execs = 0;
+    if (sscanf(afl->afl_env.igorfuzz_plateau, "%llu:%llu", &secs, &execs) < 1 ||
+        (!secs && !execs))
+      FATAL("Invalid value for " IGORFUZZ_ENV_PLATEAU ", expect secs[:execs]");
+    afl->plateau_ms = secs * 1000;
+    afl->plateau_execs = execs;
+  }
+  afl->afl_env.igorfuzz_pareto = 
+    (u8 *)get_afl_env(IGORFUZZ_ENV_PARETO);
+  if (afl->afl_env.igorfuzz_pareto) {
+    u8 *val = afl->afl_env.igorfuzz_pareto;
+    s32 n = 0;
+    afl->pareto_reserve = IGORFUZZ_PARETO_RESERVE;
+    if (*val && (sscanf(val, "%u%n", &afl->pareto_reserve, &n) != 1 || val[n]))
+      FATAL("Invalid value for " IGORFUZZ_ENV_PARETO ", expect [reserve]");
+  }
+  afl->afl_env.igorfuzz_pareto_move = 
+    get_afl_env(IGORFUZZ_ENV_PARETO_MOVE) ? 1 : 0;
+  afl->afl_env.igorfuzz_fastcal = 
+    get_afl_env(IGORFUZZ_ENV_FASTCAL) ? 1 : 0;
+  afl->afl_env.igorfuzz_fenwick = 
+    get_afl_env(IGORFUZZ_ENV_FENWICK) ? 1 : 0;
+  afl->afl_env.igorfuzz_cache_pin = 
+    get_afl_env(IGORFUZZ_ENV_CACHE_PIN) ? 1 : 0;
+  afl->afl_env.igorfuzz_store = 
+    get_afl_env(IGORFUZZ_ENV_STORE) ? 1 : 0;
+  afl->afl_env.igorfuzz_queue_gc = 
+    (u8 *)get_afl_env(IGORFUZZ_ENV_QUEUE_GC);
+  if (afl->afl_env.igorfuzz_queue_gc) {
+    u8 *val = afl->afl_env.igorfuzz_queue_gc;
+    s32 n = 0;
+    afl->queue_gc_min = IGORFUZZ_QUEUE_GC_MIN;
+    if (*val && (sscanf(val, "%u%n", &afl->queue_gc_min, &n) != 1 || val[n] ||
+                 !afl->queue_gc_min))
+      FATAL("Invalid value for " IGORFUZZ_ENV_QUEUE_GC ", expect [entries]");
+  }
+  afl->afl_env.igorfuzz_influence = 
+    get_afl_env(IGORFUZZ_ENV_INFLUENCE) ? 1 : 0;
+  afl->afl_env.igorfuzz_ddmin = 
+    get_afl_env(IGORFUZZ_ENV_DDMIN) ? 1 : 0;
+  afl->afl_env.igorfuzz_havoc_reduce = 
+    get_afl_env(IGORFUZZ_ENV_HAVOC_REDUCE) ? 1 : 0;
+  if (afl->afl_env.igorfuzz_havoc_reduce) { havoc_reduce_init(afl); }
   //be user-friendly :)
   if (afl->afl_env.igorfuzz_nocalstk)
     WARNF("User requests EMERGENCY STOP of callstack-check feature");
@@ -602,6 +657,10 @@ int main(int argc, char **argv_orig, char **envp) {
 
           afl->schedule = SEEK;
 
+        } else if (!stricmp(optarg, "decrease")) {
+
+          afl->schedule = DECREASE;
+
         } else {
 
           FATAL("Unknown -p power schedule");
@@ -1528,6 +1587,9 @@ int main(int argc, char **argv_orig, char **envp) {
     case SEEK:
       OKF("Using seek power schedule (SEEK)");
       break;
+    case DECREASE:
+      OKF("Using coverage-decrease power schedule (DECREASE)");
+      break;
     case EXPLORE:
       OKF("Using exploration-based constant power schedule (EXPLORE)");
       break;
@@ -1833,6 +1895,12 @@ int main(int argc, char **argv_orig, char **envp) {
 
   setup_dirs_fds(afl);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  afl->root_out_dir = afl->out_dir;
+  if (afl->crash_mode) { sym_cache_load(afl); }
+  crash_log_init(afl);
+#endif
+
   #ifdef HAVE_AFFINITY
   bind_to_free_cpu(afl);
   #endif                                                   /* HAVE_AFFINITY */
@@ -1877,6 +1945,21 @@ int main(int argc, char **argv_orig, char **envp) {
 
   setup_custom_mutators(afl);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  // Entries in the queue store have no file until the run is over
+  if (afl->afl_env.igorfuzz_store) {
+    if (afl->sync_id && strcmp(afl->sync_id, "default"))
+      FATAL(IGORFUZZ_ENV_STORE " can't be used with -M or -S");
+    if (afl->custom_mutators_count) {
+      LIST_FOREACH(&afl->custom_mutator_list, struct custom_mutator, {
+        if (el->afl_custom_queue_new_entry)
+          FATAL(IGORFUZZ_ENV_STORE " can't be used with a custom mutator "
+                "that has queue_new_entry");
+      });
+    }
+  }
+#endif
+
   write_setup_file(afl, argc, argv);
 
   setup_cmdline_file(afl, argv + optind);
@@ -1884,6 +1967,8 @@ int main(int argc, char **argv_orig, char **envp) {
 #if IGORFUZZ_FEATURE_ENABLE
   // If not in_place_resume, we only need to read one input file.
   // Or in_dir will have been set to out_dir within setup_dirs_fds.
+  // A directory of PoCs is read one by one, starting with the first here.
+  poc_pool_init(afl);
   if (!afl->in_place_resume) read_the_testcase(afl);
                      else read_testcases(afl, NULL);
 #else
@@ -1924,7 +2009,11 @@ int main(int argc, char **argv_orig, char **envp) {
 
   } else {
 
+#if IGORFUZZ_FEATURE_ENABLE
+    afl->tmp_dir = afl->root_out_dir;
+#else
     afl->tmp_dir = afl->out_dir;
+#endif
 
   }
 
@@ -1981,6 +2070,10 @@ int main(int argc, char **argv_orig, char **envp) {
       { PFATAL("Your %s is bad", afl->fsrv.call_stack_file); }
 
     setenv(IGORFUZZ_CALLSTACK_ENV_FILEPATH, afl->fsrv.call_stack_file, 1);
+
+    //The call stack channel in shared memory takes priority over
+    //the file above. The file only serves runtimes not supporting it.
+    afl->shm.callstack_mode = 1;
   }
 #endif
 
@@ -2261,6 +2354,10 @@ int main(int argc, char **argv_orig, char **envp) {
 
   cull_queue(afl);
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (afl->poc_pool) { poc_pool_dry_run(afl); }
+#endif
+
   // ensure we have at least one seed that is not disabled.
   u32 entry, valid_seeds = 0;
   for (entry = 0; entry < afl->queued_items; ++entry)
@@ -2347,6 +2444,15 @@ int main(int argc, char **argv_orig, char **envp) {
 
   while (likely(!afl->stop_soon)) {
 
+#if IGORFUZZ_FEATURE_ENABLE
+    if (unlikely(afl->poc_pool)) {
+      poc_pool_schedule(afl, &runs_in_current_cycle, &prev_queued);
+    }
+
+    // Disabling an entry asks for a new alias table, that's when to look
+    if (unlikely(afl->queue_gc_min && afl->reinit_table)) { queue_gc(afl); }
+#endif
+
     cull_queue(afl);
 
     if (unlikely((!afl->old_seed_selection &&
@@ -2431,7 +2537,12 @@ int main(int argc, char **argv_orig, char **envp) {
       /* If we had a full queue cycle with no new finds, try
          recombination strategies next. */
 
+#if IGORFUZZ_FEATURE_ENABLE
+      // Collected entries still count as finds of their cycle
+      if (unlikely(afl->queued_items + afl->queued_collected == prev_queued
+#else
       if (unlikely(afl->queued_items == prev_queued
+#endif
                    /* FIXME TODO BUG: && (get_cur_time() - afl->start_time) >=
                       3600 */
                    )) {
@@ -2573,7 +2684,11 @@ int main(int argc, char **argv_orig, char **envp) {
 
       }
 
+#if IGORFUZZ_FEATURE_ENABLE
+      prev_queued = afl->queued_items + afl->queued_collected;
+#else
       prev_queued = afl->queued_items;
+#endif
 
     }
 
@@ -2588,7 +2703,20 @@ int main(int argc, char **argv_orig, char **envp) {
 
           // we have new queue entries since the last run, recreate alias table
           prev_queued_items = afl->queued_items;
+#if IGORFUZZ_FEATURE_ENABLE
+          if (afl->afl_env.igorfuzz_fenwick) {
+
+            update_sampler(afl);
+
+          } else {
+
+            create_alias_table(afl);
+
+          }
+
+#else
           create_alias_table(afl);
+#endif
 
         }
 
@@ -2704,6 +2832,10 @@ stop_fuzzing:
   show_stats(afl);           // print the screen one last time
   write_bitmap(afl);
   save_auto(afl);
+#if IGORFUZZ_FEATURE_ENABLE
+  if (afl->crash_mode) { sym_cache_save(afl); }
+  crash_log_flush(afl);
+#endif
 
   if (afl->pizza_is_served) {
 
@@ -2729,6 +2861,14 @@ stop_fuzzing:
 
   }
 
+#if IGORFUZZ_FEATURE_ENABLE
+  if (afl->plateau_reached) {
+
+    SAYF(cYEL "[!] " cRST "Coverage-decrease reached a plateau\n");
+
+  }
+#endif
+
   /* Running for more than 30 minutes but still doing first cycle? */
 
   if (afl->queue_cycle == 1 &&
@@ -2773,6 +2913,9 @@ stop_fuzzing:
   if (frida_afl_preload) { ck_free(frida_afl_preload); }
 
   fclose(afl->fsrv.plot_file);
+#if IGORFUZZ_FEATURE_ENABLE
+  poc_pool_destroy(afl);
+#endif
   destroy_queue(afl);
   destroy_extras(afl);
   destroy_custom_mutators(afl);
@@ -2792,8 +2935,12 @@ stop_fuzzing:
     ck_free(afl->fsrv.call_stack_file);
     ck_free(afl->fsrv.crash_symbol);
     ck_free(afl->fsrv.crash_module);
+    sym_cache_destroy(afl);
     SanSymTool_fini(); //Ignore errors
   }
+  if (afl->sweep_hash_state) { hash64_stream_free(afl->sweep_hash_state); }
+  crash_log_close(afl);
+  if (afl->plateau_reached) { exit_code = IGORFUZZ_PLATEAU_EXIT_CODE; }
 #endif
 
   /* remove tmpfile */
@@ -2817,7 +2964,11 @@ stop_fuzzing:
 
   OKF("We're done here. Have a nice day!\n");
 
+#if IGORFUZZ_FEATURE_ENABLE
+  exit(exit_code);
+#else
   exit(0);
+#endif
 
 }
 
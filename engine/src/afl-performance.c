@@ -108,3 +108,34 @@ inline u64 hash64(u8 *key, u32 len, u64 seed) {
 
 }
 
+void *hash64_stream_new(void) {
+
+  XXH3_state_t *state = XXH3_createState();
+  if (unlikely(!state)) { PFATAL("XXH3_createState failed"); }
+  return state;
+
+}
+
+void hash64_stream_free(void *state) {
+
+  XXH3_freeState((XXH3_state_t *)state);
+
+}
+
+void hash64_stream_reset(void *state) {
+
+  XXH3_64bits_reset((XXH3_state_t *)state);
+
+}
+
+void hash64_stream_update(void *state, u8 *key, u32 len) {
+
+  XXH3_64bits_update((XXH3_state_t *)state, key, len);
+
+}
+
+u64 hash64_stream_digest(void *state) {
+
+  return XXH3_64bits_digest((XXH3_state_t *)state);
+
+}
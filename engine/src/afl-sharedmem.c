@@ -36,6 +36,7 @@
 #include "hash.h"
 #include "sharedmem.h"
 #include "cmplog.h"
+#include "callstack.h"
 #include "list.h"
 
 #include <stdio.h>
@@ -127,9 +128,49 @@ void afl_shm_deinit(sharedmem_t *shm) {
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode) {
+
+    unsetenv(IGORFUZZ_CALLSTACK_SHM_ENV_VAR);
+
+    if (shm->stack_map != NULL) {
+
+      munmap(shm->stack_map, sizeof(struct igorfuzz_stack_map));
+      shm->stack_map = NULL;
+
+    }
+
+    if (shm->callstack_g_shm_fd != -1) {
+
+      close(shm->callstack_g_shm_fd);
+      shm->callstack_g_shm_fd = -1;
+
+    }
+
+    if (shm->callstack_g_shm_file_path[0]) {
+
+      shm_unlink(shm->callstack_g_shm_file_path);
+      shm->callstack_g_shm_file_path[0] = 0;
+
+    }
+
+  }
+
+  #endif
+
 #else
   shmctl(shm->shm_id, IPC_RMID, NULL);
   if (shm->cmplog_mode) { shmctl(shm->cmplog_shm_id, IPC_RMID, NULL); }
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode) {
+
+    unsetenv(IGORFUZZ_CALLSTACK_SHM_ENV_VAR);
+    shmctl(shm->callstack_shm_id, IPC_RMID, NULL);
+    shm->stack_map = NULL;
+
+  }
+
+  #endif
 #endif
 
   shm->map = NULL;
@@ -147,11 +188,17 @@ u8 *afl_shm_init(sharedmem_t *shm, size_t map_size,
 
   shm->map = NULL;
   shm->cmp_map = NULL;
+#if IGORFUZZ_FEATURE_ENABLE
+  shm->stack_map = NULL;
+#endif
 
 #ifdef USEMMAP
 
   shm->g_shm_fd = -1;
   shm->cmplog_g_shm_fd = -1;
+  #if IGORFUZZ_FEATURE_ENABLE
+  shm->callstack_g_shm_fd = -1;
+  #endif
 
   const int shmflags = O_RDWR | O_EXCL;
 
@@ -271,6 +318,47 @@ u8 *afl_shm_init(sharedmem_t *shm, size_t map_size,
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode) {
+
+    snprintf(shm->callstack_g_shm_file_path, L_tmpnam, "/afl_callstack_%d_%ld",
+             getpid(), random());
+
+    /* create the shared memory segment as if it was a file */
+    shm->callstack_g_shm_fd =
+        shm_open(shm->callstack_g_shm_file_path, O_CREAT | O_RDWR | O_EXCL,
+                 DEFAULT_PERMISSION);
+    if (shm->callstack_g_shm_fd == -1) { PFATAL("shm_open() failed"); }
+
+    /* configure the size of the shared memory segment */
+    if (ftruncate(shm->callstack_g_shm_fd,
+                  sizeof(struct igorfuzz_stack_map))) {
+
+      PFATAL("setup_shm(): callstack ftruncate() failed");
+
+    }
+
+    /* map the shared memory segment to the address space of the process */
+    shm->stack_map =
+        mmap(0, sizeof(struct igorfuzz_stack_map), PROT_READ | PROT_WRITE,
+             MAP_SHARED, shm->callstack_g_shm_fd, 0);
+    if (shm->stack_map == MAP_FAILED) {
+
+      close(shm->callstack_g_shm_fd);
+      shm->callstack_g_shm_fd = -1;
+      shm_unlink(shm->callstack_g_shm_file_path);
+      shm->callstack_g_shm_file_path[0] = 0;
+      PFATAL("callstack mmap() failed");
+
+    }
+
+    if (!non_instrumented_mode)
+      setenv(IGORFUZZ_CALLSTACK_SHM_ENV_VAR, shm->callstack_g_shm_file_path, 1);
+
+  }
+
+  #endif
+
 #else
   u8 *shm_str;
 
@@ -299,6 +387,25 @@ u8 *afl_shm_init(sharedmem_t *shm, size_t map_size,
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode) {
+
+    shm->callstack_shm_id =
+        shmget(IPC_PRIVATE, sizeof(struct igorfuzz_stack_map),
+               IPC_CREAT | IPC_EXCL | DEFAULT_PERMISSION);
+
+    if (shm->callstack_shm_id < 0) {
+
+      shmctl(shm->shm_id, IPC_RMID, NULL);  // do not leak shmem
+      if (shm->cmplog_mode) { shmctl(shm->cmplog_shm_id, IPC_RMID, NULL); }
+      PFATAL("shmget() failed, try running afl-system-config");
+
+    }
+
+  }
+
+  #endif
+
   if (!non_instrumented_mode) {
 
     shm_str = alloc_printf("%d", shm->shm_id);
@@ -324,6 +431,19 @@ u8 *afl_shm_init(sharedmem_t *shm, size_t map_size,
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode && !non_instrumented_mode) {
+
+    shm_str = alloc_printf("%d", shm->callstack_shm_id);
+
+    setenv(IGORFUZZ_CALLSTACK_SHM_ENV_VAR, shm_str, 1);
+
+    ck_free(shm_str);
+
+  }
+
+  #endif
+
   shm->map = shmat(shm->shm_id, NULL, 0);
 
   if (shm->map == (void *)-1 || !shm->map) {
@@ -356,6 +476,25 @@ u8 *afl_shm_init(sharedmem_t *shm, size_t map_size,
 
   }
 
+  #if IGORFUZZ_FEATURE_ENABLE
+  if (shm->callstack_mode) {
+
+    shm->stack_map = shmat(shm->callstack_shm_id, NULL, 0);
+
+    if (shm->stack_map == (void *)-1 || !shm->stack_map) {
+
+      shmctl(shm->shm_id, IPC_RMID, NULL);  // do not leak shmem
+      if (shm->cmplog_mode) { shmctl(shm->cmplog_shm_id, IPC_RMID, NULL); }
+      shmctl(shm->callstack_shm_id, IPC_RMID, NULL);  // do not leak shmem
+
+      PFATAL("shmat() failed");
+
+    }
+
+  }
+
+  #endif
+
 #endif
 
   shm->map_size = map_size;
@@ -73,6 +73,26 @@ test -e test-custom-mutator.c -a -e ${CUSTOM_MUTATOR_PATH}/example.c -a -e ${CUS
 
     # Clean
     rm -rf out errors core.*
+
+    # Run afl-fuzz w/ a mutator checking each afl_custom_reduce_feedback
+    $ECHO "$GREY[*] running afl-fuzz with the reduce_feedback checker, this will take approx 10 seconds"
+    cc -g -fPIC -shared -I../include ../custom_mutators/examples/reduce_feedback.c -o libreducefeedback.so > /dev/null 2>&1
+    {
+      AFL_CUSTOM_MUTATOR_LIBRARY="./libexamplemutator.so;./libreducefeedback.so" AFL_CUSTOM_MUTATOR_ONLY=1 ../afl-fuzz -V07 -m ${MEM_LIMIT} -i in -o out -- ./test-custom-mutator >>errors 2>&1
+    } >>errors 2>&1
+
+    grep -q "reduce_feedback: [0-9]* calls" errors && ! grep -q "does not hold" errors && {
+      $ECHO "$GREEN[+] afl-fuzz reports consistent reduce_feedback fields"
+    } || {
+      echo CUT------------------------------------------------------------------CUT
+      cat errors
+      echo CUT------------------------------------------------------------------CUT
+      $ECHO "$RED[!] afl-fuzz reports inconsistent reduce_feedback fields"
+      CODE=1
+    }
+
+    # Clean
+    rm -rf out errors core.* libreducefeedback.so
   } || {
     ls .
     ls ${CUSTOM_MUTATOR_PATH}
@@ -0,0 +1,78 @@
+#!/bin/bash
+
+# Compares power schedules on how fast they drive a fixed set of PoCs to
+# their minimum. Each PoC is reduced on its own for a fixed time with
+# every schedule, then the final min_bitmap_size / min_actual_cnts and
+# the time of the last decrease (time-to-minimum) are taken from
+# fuzzer_stats. Runs without any decrease have no time-to-minimum; they
+# are counted apart and left out of its mean.
+#
+# Usage: ./test-decrease-schedule.sh poc_dir seconds -- /path/to/target [args]
+#
+#   SCHEDULES  schedules to compare (default: "fast decrease")
+#   RUNS       runs per PoC and schedule, with seeds 1..RUNS (default: 1)
+#   FUZZARGS   extra afl-fuzz arguments (default: -C)
+#   BENCH_OUT  where the runs go (default: a fresh mktemp -d)
+
+test -e ./test-decrease-schedule.sh || { echo Error: this script must be run from the directory in which it lies. ; exit 1 ; }
+
+POCS=$1
+SECS=$2
+shift 2
+test "$1" = "--" && shift
+test -d "$POCS" -a -n "$SECS" -a -n "$1" || {
+  echo "Usage: $0 poc_dir seconds -- /path/to/target [args]"
+  exit 1
+}
+
+AFL_FUZZ=`pwd`/../afl-fuzz
+test -x "$AFL_FUZZ" || { echo Error: afl-fuzz is not built ; exit 1 ; }
+
+SCHEDULES=${SCHEDULES:-fast decrease}
+RUNS=${RUNS:-1}
+FUZZARGS=${FUZZARGS:--C}
+OUT=${BENCH_OUT:-`mktemp -d`}
+
+export AFL_SKIP_CPUFREQ=1
+export AFL_NO_UI=1
+export AFL_I_DONT_CARE_ABOUT_MISSING_CRASHES=1
+unset IGORFUZZ_PLATEAU
+
+stat_of() {
+  grep "^$2 " "$1" | sed 's/.*: //'
+}
+
+echo "PoCs from $POCS, $SECS s per run, $RUNS run(s), results in $OUT"
+printf "%-24s %-10s %12s %16s %8s\n" poc schedule min_bitmap min_actual_cnts ttm_s
+
+for S in $SCHEDULES; do
+  TOTAL_TTM=0
+  TOTAL_BMS=0
+  N=0
+  N_TTM=0
+  for POC in "$POCS"/*; do
+    test -f "$POC" || continue
+    NAME=`basename "$POC"`
+    for SEED in `seq 1 $RUNS`; do
+      DIR="$OUT/$S/$NAME.$SEED"
+      mkdir -p "$OUT/$S"
+      "$AFL_FUZZ" $FUZZARGS -p $S -s $SEED -V $SECS -i "$POC" -o "$DIR" -- "$@" > "$DIR.log" 2>&1
+      STATS="$DIR/default/fuzzer_stats"
+      test -f "$STATS" || { echo "Error: $NAME with $S failed, see $DIR.log" ; continue ; }
+      BMS=`stat_of "$STATS" min_bitmap_size`
+      HITS=`stat_of "$STATS" min_actual_cnts`
+      LAST=`stat_of "$STATS" last_decrease`
+      printf "%-24s %-10s %12s %16s %8s\n" "$NAME" $S $BMS $HITS $LAST
+      if [ "$LAST" != none ]; then
+        TOTAL_TTM=$((TOTAL_TTM + LAST))
+        N_TTM=$((N_TTM + 1))
+      fi
+      TOTAL_BMS=$((TOTAL_BMS + BMS))
+      N=$((N + 1))
+    done
+  done
+  MEAN_TTM=-
+  test $N_TTM -gt 0 && MEAN_TTM=$((TOTAL_TTM / N_TTM))
+  test $N -gt 0 && printf "%-24s %-10s %12s %16s %8s\n" "== mean" $S $((TOTAL_BMS / N)) - $MEAN_TTM
+  test $N -gt 0 && echo "   $S: $((N - N_TTM)) of $N run(s) never decreased"
+done
@@ -0,0 +1,245 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <cmocka.h>
+/* cmocka < 1.0 didn't support these features we need */
+#ifndef assert_ptr_equal
+#define assert_ptr_equal(a, b) \
+    _assert_int_equal(cast_ptr_to_largest_integral_type(a), \
+                      cast_ptr_to_largest_integral_type(b), \
+                      __FILE__, __LINE__)
+#define CMUnitTest UnitTest
+#define cmocka_unit_test unit_test
+#define cmocka_run_group_tests(t, setup, teardown) run_tests(t)
+#endif
+
+
+extern void mock_assert(const int result, const char* const expression,
+                        const char * const file, const int line);
+#undef assert
+#define assert(expression) \
+    mock_assert((int)(expression), #expression, __FILE__, __LINE__);
+
+/* cull_favored is static, so the queue code comes in whole */
+#include "../../src/afl-fuzz-queue.c"
+
+#include <dirent.h>
+
+/* remap exit -> assert, then use cmocka's mock_assert
+    (compile with `--wrap=exit`) */
+extern void exit(int status);
+extern void __real_exit(int status);
+void __wrap_exit(int status);
+void __wrap_exit(int status) {
+    (void)status;
+    assert(0);
+}
+
+/* ignore all printfs */
+#undef printf
+extern int printf(const char *format, ...);
+extern int __real_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...) {
+    (void)format;
+    return 1;
+}
+
+/* What the rest of afl-fuzz would provide, no store and no mutators */
+u8 *queue_store_claim(afl_state_t *afl, u8 *fname) { (void)afl; (void)fname; return NULL; }
+void queue_store_move(afl_state_t *afl, struct queue_entry *q, u8 *fname) { (void)afl; (void)q; (void)fname; }
+void queue_store_export(afl_state_t *afl) { (void)afl; }
+void queue_store_evict(struct queue_entry *q) { (void)q; }
+void queue_store_close(afl_state_t *afl) { (void)afl; }
+void run_afl_custom_queue_new_entry(afl_state_t *afl, struct queue_entry *q,
+                                    u8 *fname, u8 *mother) {
+    (void)afl; (void)q; (void)fname; (void)mother;
+}
+
+u32 trace_nonzero(afl_state_t *afl) {
+    afl->trace_nz_cnt = 0;
+    for (u32 i = 0; i < afl->fsrv.map_size; ++i)
+        if (afl->fsrv.trace_bits[i]) afl->trace_nz[afl->trace_nz_cnt++] = i;
+    return afl->trace_nz_cnt;
+}
+
+#define TEST_MAP_SIZE 4096
+#define TEST_MATRIX_EDGES 300
+#define TEST_STEPS 1500
+
+static u8 trace[TEST_MAP_SIZE];
+static char out_dir[] = "/tmp/unit_cull.XXXXXX";
+
+static const char *dirs[] = {"queue", "queue/.state", "queue/.state/redundant_edges"};
+
+static afl_state_t *cull_setup(void) {
+
+    afl_state_t *afl = calloc(1, sizeof(afl_state_t));
+
+    // mark_as_redundant keeps its marks in there
+    assert_non_null(mkdtemp(out_dir));
+    for (u32 i = 0; i < 3; ++i) {
+        u8 *dir = alloc_printf("%s/%s", out_dir, dirs[i]);
+        assert_int_equal(mkdir((char *)dir, 0700), 0);
+        ck_free(dir);
+    }
+
+    afl->out_dir = (u8 *)out_dir;
+    afl->fsrv.map_size = TEST_MAP_SIZE;
+    afl->fsrv.trace_bits = trace;
+    afl->top_rated = ck_alloc(TEST_MAP_SIZE * sizeof(struct queue_entry *));
+    afl->map_tmp_buf = ck_alloc(TEST_MAP_SIZE);
+    afl->trace_nz = ck_alloc(TEST_MAP_SIZE * sizeof(u32));
+    // Winners by len only, so the trace decides alone
+    afl->fixed_seed = 1;
+    return afl;
+
+}
+
+static void cull_teardown(afl_state_t *afl) {
+
+    u8 *dir = alloc_printf("%s/%s", out_dir, dirs[2]);
+    DIR *d = opendir((char *)dir);
+    struct dirent *e;
+
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        u8 *fn = alloc_printf("%s/%s", dir, e->d_name);
+        unlink((char *)fn);
+        ck_free(fn);
+    }
+    closedir(d);
+    ck_free(dir);
+    for (u32 i = 3; i--;) {
+        dir = alloc_printf("%s/%s", out_dir, dirs[i]);
+        rmdir((char *)dir);
+        ck_free(dir);
+    }
+    rmdir(out_dir);
+    strcpy(out_dir, "/tmp/unit_cull.XXXXXX");
+
+    destroy_queue(afl);
+    afl_free(afl->queue_buf);
+    ck_free(afl->top_rated);
+    ck_free(afl->map_tmp_buf);
+    ck_free(afl->trace_nz);
+    ck_free(afl->matrix_edges);
+    ck_free(afl->cull_edges);
+    ck_free(afl->cull_winners);
+    ck_free(afl->cull_snaps);
+    free(afl);
+
+}
+
+/* Queue an entry with the trace in trace[] and score it */
+static struct queue_entry *cull_add(afl_state_t *afl, u32 len) {
+
+    add_to_queue(afl, alloc_printf("%s/queue/id:%06u", out_dir, afl->queued_items), len, 0);
+    struct queue_entry *q = afl->queue_buf[afl->queued_items - 1];
+    update_bitmap_score(afl, q);
+    return q;
+
+}
+
+/* The whole greedy cull from scratch, over matrix edges in order */
+static void cull_reference(afl_state_t *afl, u8 *fav) {
+
+    u8 *temp = calloc(afl->matrix_edges_cnt, 1);
+
+    memset(fav, 0, afl->queued_items);
+    memset(temp, 1, afl->matrix_edges_cnt);
+
+    for (u32 k = 0; k < afl->matrix_edges_cnt; ++k) {
+
+        struct queue_entry *q = afl->top_rated[afl->matrix_edges[k]];
+        if (!temp[k] || !q || q->disabled) continue;
+
+        for (u32 n = 0; n < afl->matrix_edges_cnt; ++n) {
+            u32 i = afl->matrix_edges[n];
+            if (!(q->trace_mini[i >> 3] & (1 << (i & 7)))) temp[n] = 0;
+        }
+        fav[q->id] = 1;
+
+    }
+
+    free(temp);
+
+}
+
+/* After every add or disable, cull_queue must favor exactly what a full
+   recompute does, whatever picks it kept from the cull before */
+static void test_cull_incremental(void **state) {
+    (void)state;
+
+    for (u32 seed = 1; seed <= 8; ++seed) {
+
+        afl_state_t *afl = cull_setup();
+        u8 *fav = calloc(TEST_STEPS + 1, 1);
+        u32 i;
+
+        srandom(seed);
+
+        // The matrix, on a random subset of the map
+        memset(trace, 0, sizeof(trace));
+        for (i = 0; i < TEST_MATRIX_EDGES; ++i) trace[random() % TEST_MAP_SIZE] = 1;
+        afl->testcase_matrix = cull_add(afl, 1000);
+
+        for (u32 step = 0; step < TEST_STEPS; ++step) {
+
+            u32 n = afl->queued_items;
+
+            if (n > 1 && random() % 4 == 0) {
+
+                struct queue_entry *q = afl->queue_buf[1 + random() % (n - 1)];
+                if (!q->disabled) QUEUE_HOT_SET(afl, q, disabled, 1);
+                afl->score_changed = 1;
+
+            } else {
+
+                // Lose some matrix edges, gain a few off it
+                memset(trace, 0, sizeof(trace));
+                for (i = 0; i < afl->matrix_edges_cnt; ++i)
+                    if (random() % 8) trace[afl->matrix_edges[i]] = 1;
+                for (i = 0; i < 5; ++i) trace[random() % TEST_MAP_SIZE] = 1;
+                cull_add(afl, 1 + random() % 900);
+
+            }
+
+            cull_queue(afl);
+            cull_reference(afl, fav);
+
+            u32 favored = 0, pending = 0;
+            for (i = 0; i < afl->queued_items; ++i) {
+                struct queue_entry *q = afl->queue_buf[i];
+                assert_int_equal(q->favored, fav[i]);
+                assert_int_equal(afl->q_hot.favored[i], fav[i]);
+                favored += fav[i];
+                pending += fav[i] && !q->was_fuzzed;
+            }
+            assert_int_equal(afl->queued_favored, favored);
+            assert_int_equal(afl->pending_favored, pending);
+
+        }
+
+        free(fav);
+        cull_teardown(afl);
+
+    }
+
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_cull_incremental)
+    };
+
+    //return cmocka_run_group_tests (tests, setup, teardown);
+    __real_exit( cmocka_run_group_tests (tests, NULL, NULL) );
+
+    // fake return for dumb compilers
+    return 0;
+}
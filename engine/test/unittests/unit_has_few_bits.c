@@ -0,0 +1,368 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <cmocka.h>
+/* cmocka < 1.0 didn't support these features we need */
+#ifndef assert_ptr_equal
+#define assert_ptr_equal(a, b) \
+    _assert_int_equal(cast_ptr_to_largest_integral_type(a), \
+                      cast_ptr_to_largest_integral_type(b), \
+                      __FILE__, __LINE__)
+#define CMUnitTest UnitTest
+#define cmocka_unit_test unit_test
+#define cmocka_run_group_tests(t, setup, teardown) run_tests(t)
+#endif
+
+
+extern void mock_assert(const int result, const char* const expression,
+                        const char * const file, const int line);
+#undef assert
+#define assert(expression) \
+    mock_assert((int)(expression), #expression, __FILE__, __LINE__);
+
+#include "afl-fuzz.h"
+#include "hash.h"
+
+/* coverage-64.h expects these from afl-fuzz-bitmap.c */
+const u8 simplify_lookup[256] = {0};
+u16 count_class_lookup16[65536];
+
+#ifdef WORD_SIZE_64
+  #include "coverage-64.h"
+  #define WORD_T u64
+#else
+  #include "coverage-32.h"
+  #define WORD_T u32
+#endif
+
+/* remap exit -> assert, then use cmocka's mock_assert
+    (compile with `--wrap=exit`) */
+extern void exit(int status);
+extern void __real_exit(int status);
+void __wrap_exit(int status);
+void __wrap_exit(int status) {
+    (void)status;
+    assert(0);
+}
+
+/* ignore all printfs */
+#undef printf
+extern int printf(const char *format, ...);
+extern int __real_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...) {
+    (void)format;
+    return 1;
+}
+
+#define TEST_MAP_SIZE (1 << 16)
+
+static u8 cur_map[TEST_MAP_SIZE] __attribute__((aligned(64)));
+static u8 vir_ref[TEST_MAP_SIZE] __attribute__((aligned(64)));
+static u8 vir_vec[TEST_MAP_SIZE] __attribute__((aligned(64)));
+
+/* The byte-wise scan has_few_bits did before the kernels came in */
+static u8 scalar_decrease(u8 *virgin_map, u8 *trace_bits, u32 len, u8 hcn_check) {
+
+    u8 cov = 0, hcn = 0;
+
+    for (u32 i = 0; i < len; i += sizeof(WORD_T)) {
+
+        WORD_T c = *(WORD_T *)(trace_bits + i), v = *(WORD_T *)(virgin_map + i);
+        if (!(WORD_T)(v + 1)) continue;
+
+        if (hcn_check && (c & v)) hcn = 1;
+
+        for (u32 j = 0; j < sizeof(WORD_T); ++j) {
+            if (virgin_map[i + j] != 0xff && !trace_bits[i + j]) {
+                virgin_map[i + j] = 0xff;
+                cov = 1;
+            }
+        }
+
+    }
+
+    return (cov << 1) | hcn;
+
+}
+
+static u8 few_bits_ref(u8 bms, u8 hcn_check) {
+    return 0x10 + (bms << 2) + scalar_decrease(vir_ref, cur_map, TEST_MAP_SIZE, hcn_check);
+}
+
+static u8 few_bits_vec(u8 bms, u8 hcn_check) {
+    WORD_T *end = (WORD_T *)(cur_map + TEST_MAP_SIZE);
+    return 0x10 + (bms << 2) + skim_decrease((WORD_T *)vir_vec, (WORD_T *)cur_map, end, hcn_check);
+}
+
+/* Matrix touches a sparse set of edges, current keeps or drops them */
+static void fill_maps(u32 seed, u8 drop, u8 fresh) {
+
+    srandom(seed);
+    memset(cur_map, 0, sizeof(cur_map));
+    memset(vir_ref, 0xff, sizeof(vir_ref));
+
+    for (u32 n = 0; n < 2000; ++n) {
+
+        u32 pos = random() % TEST_MAP_SIZE;
+        u8  hit = 1 << (random() % 8);
+        vir_ref[pos] &= ~hit;
+        if (!drop || random() % 64) cur_map[pos] |= hit;
+
+    }
+
+    // some bits in current not yet cleared from virgin
+    if (fresh) {
+        for (u32 n = 0; n < 16; ++n) {
+            u32 pos = random() % TEST_MAP_SIZE;
+            if (vir_ref[pos] == 0xff) continue;
+            cur_map[pos] |= vir_ref[pos] & (u8)-vir_ref[pos];
+        }
+    }
+
+    memcpy(vir_vec, vir_ref, sizeof(vir_ref));
+
+}
+
+static void test_has_few_bits_codes(void **state) {
+    (void)state;
+
+    u8 seen[8] = {0};
+
+    for (u32 seed = 0; seed < 64; ++seed) {
+        for (u8 flags = 0; flags < 8; ++flags) {
+
+            u8 bms = (flags >> 2) & 1, drop = (flags >> 1) & 1, fresh = flags & 1;
+            fill_maps(seed, drop, fresh);
+
+            u8 ref = few_bits_ref(bms, 1);
+            u8 vec = few_bits_vec(bms, 1);
+
+            assert_int_equal(ref, vec);
+            assert_true(ref >= 0x10 && ref <= 0x17);
+            assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+            seen[ref - 0x10] = 1;
+
+            // no hit counts decrease means no hcn bit at all
+            fill_maps(seed, drop, fresh);
+            assert_int_equal(few_bits_ref(bms, 0), few_bits_vec(bms, 0));
+            assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+
+        }
+    }
+
+    for (u32 i = 0; i < 8; ++i) assert_true(seen[i]);
+
+}
+
+static void test_has_few_bits_untouched(void **state) {
+    (void)state;
+
+    // nothing in the matrix, nothing may ever decrease
+    memset(vir_ref, 0xff, sizeof(vir_ref));
+    memset(vir_vec, 0xff, sizeof(vir_vec));
+    memset(cur_map, 0, sizeof(cur_map));
+    assert_int_equal(few_bits_vec(0, 1), 0x10);
+
+    // matrix touched every byte, current still hits all of them
+    memset(vir_ref, 0x7f, sizeof(vir_ref));
+    memset(vir_vec, 0x7f, sizeof(vir_vec));
+    memset(cur_map, 0x80, sizeof(cur_map));
+    assert_int_equal(few_bits_ref(0, 1), few_bits_vec(0, 1));
+    assert_int_equal(few_bits_vec(0, 1), 0x10);
+
+    // a single lost edge in the last byte of the map
+    cur_map[TEST_MAP_SIZE - 1] = 0;
+    assert_int_equal(few_bits_ref(1, 1), few_bits_vec(1, 1));
+    assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+    assert_int_equal(vir_vec[TEST_MAP_SIZE - 1], 0xff);
+    assert_int_equal(vir_vec[TEST_MAP_SIZE - 2], 0x7f);
+
+}
+
+static void test_has_few_bits_sparse(void **state) {
+    (void)state;
+
+    static u32 idx[TEST_MAP_SIZE / sizeof(WORD_T)];
+
+    for (u32 seed = 0; seed < 64; ++seed) {
+
+        fill_maps(seed, seed & 1, seed & 2);
+
+        // index of still touched words, as has_few_bits keeps for virgin_bits
+        u32 cnt = 0;
+        for (u32 w = 0; w < TEST_MAP_SIZE / sizeof(WORD_T); ++w)
+            if ((WORD_T)(((WORD_T *)vir_vec)[w] + 1)) idx[cnt++] = w;
+
+        u8 ref = scalar_decrease(vir_ref, cur_map, TEST_MAP_SIZE, 1);
+        u8 dec = skim_decrease_sparse((WORD_T *)vir_vec, (WORD_T *)cur_map, idx, &cnt, 1);
+
+        assert_int_equal(ref, dec);
+        assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+
+        // words which lost all their edges left the index, the rest stay sorted
+        u32 left = 0;
+        for (u32 w = 0; w < TEST_MAP_SIZE / sizeof(WORD_T); ++w)
+            if ((WORD_T)(((WORD_T *)vir_vec)[w] + 1)) assert_int_equal(idx[left++], w);
+        assert_int_equal(left, cnt);
+
+    }
+
+}
+
+static void test_edge_hits(void **state) {
+    (void)state;
+
+    static u8 min_ref[TEST_MAP_SIZE], min_vec[TEST_MAP_SIZE];
+
+    for (u32 seed = 0; seed < 64; ++seed) {
+
+        srandom(seed);
+        memset(min_ref, 0, sizeof(min_ref));
+        memset(cur_map, 0, sizeof(cur_map));
+
+        // minimums for the edges of the matrix, raw counts of a new run
+        for (u32 n = 0; n < 2000; ++n) min_ref[random() % TEST_MAP_SIZE] = 1 + random() % 255;
+        for (u32 n = 0; n < 2000; ++n) {
+            u32 pos = random() % TEST_MAP_SIZE;
+            cur_map[pos] = min_ref[pos] && (seed & 1) ? min_ref[pos] - random() % 2 : random();
+        }
+        memcpy(min_vec, min_ref, sizeof(min_ref));
+
+        u8 ref = 0;
+        for (u32 i = 0; i < TEST_MAP_SIZE; ++i) {
+            if (cur_map[i] && cur_map[i] < min_ref[i]) { min_ref[i] = cur_map[i]; ref = 1; }
+        }
+
+        assert_int_equal(ref, skim_edge_hits(min_vec, cur_map, cur_map + TEST_MAP_SIZE));
+        assert_memory_equal(min_ref, min_vec, TEST_MAP_SIZE);
+
+    }
+
+}
+
+static void test_classify_decrease(void **state) {
+    (void)state;
+
+    static u8 raw_map[TEST_MAP_SIZE] __attribute__((aligned(64)));
+    afl_forkserver_t fsrv = {0};
+    fsrv.map_size = TEST_MAP_SIZE;
+
+    for (u32 i = 0; i < 65536; ++i) count_class_lookup16[i] = i ? 0x0101 : 0;
+
+    for (u32 seed = 0; seed < 16; ++seed) {
+
+        fill_maps(seed, seed & 1, seed & 2);
+        for (u32 i = 0; i < TEST_MAP_SIZE; ++i) raw_map[i] = cur_map[i] * 3;
+        raw_map[TEST_MAP_SIZE - 1] = 0xff;
+
+        // classify_counts, count_bytes, skim_decrease and hash64 one by one
+        memcpy(cur_map, raw_map, TEST_MAP_SIZE);
+        fsrv.trace_bits = cur_map;
+        classify_counts(&fsrv);
+        u64 ref_hits = fsrv.actual_counts;
+        u32 ref_bytes = 0;
+        for (u32 i = 0; i < TEST_MAP_SIZE; ++i) ref_bytes += !!raw_map[i];
+        u8  ref_dec = scalar_decrease(vir_ref, cur_map, TEST_MAP_SIZE, 1);
+        u64 ref_cksum = hash64(cur_map, TEST_MAP_SIZE, HASH_CONST);
+        u8  ref_classified[TEST_MAP_SIZE];
+        memcpy(ref_classified, cur_map, TEST_MAP_SIZE);
+
+        // and all of them in a single sweep
+        void *hash_state = hash64_stream_new();
+        hash64_stream_reset(hash_state);
+        u32 bytes;
+        memcpy(cur_map, raw_map, TEST_MAP_SIZE);
+        u8 dec = classify_decrease(&fsrv, vir_vec, &bytes, hash_state, NULL, NULL, NULL);
+
+        assert_int_equal(dec, ref_dec);
+        assert_int_equal(bytes, ref_bytes);
+        assert_int_equal(fsrv.actual_counts, ref_hits);
+        assert_int_equal(hash64_stream_digest(hash_state), ref_cksum);
+        assert_memory_equal(cur_map, ref_classified, TEST_MAP_SIZE);
+        assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+        hash64_stream_free(hash_state);
+
+    }
+
+}
+
+static void test_nonzero(void **state) {
+    (void)state;
+
+    static u32 pos[TEST_MAP_SIZE];
+
+    for (u32 seed = 0; seed < 16; ++seed) {
+
+        fill_maps(seed, seed & 1, seed & 2);
+        if (seed == 15) memset(cur_map, 0x80, sizeof(cur_map));
+
+        u32 cnt = skim_nonzero(pos, cur_map, cur_map + TEST_MAP_SIZE), n = 0;
+        for (u32 i = 0; i < TEST_MAP_SIZE; ++i) {
+            if (!cur_map[i]) continue;
+            assert_true(n < cnt);
+            assert_int_equal(pos[n++], i);
+        }
+        assert_int_equal(n, cnt);
+
+    }
+
+    memset(cur_map, 0, sizeof(cur_map));
+    assert_int_equal(skim_nonzero(pos, cur_map, cur_map + TEST_MAP_SIZE), 0);
+
+}
+
+static void test_var_bytes(void **state) {
+    (void)state;
+
+    static u8 first[TEST_MAP_SIZE], var_ref[TEST_MAP_SIZE], var_vec[TEST_MAP_SIZE];
+
+    for (u32 seed = 0; seed < 16; ++seed) {
+
+        fill_maps(seed, 0, 0);
+        memcpy(first, cur_map, TEST_MAP_SIZE);
+        memset(var_ref, 0, sizeof(var_ref));
+        for (u32 n = 0; n < 64; ++n) var_ref[random() % TEST_MAP_SIZE] = 1;
+        for (u32 n = 0; n < 64 * seed; ++n) cur_map[random() % TEST_MAP_SIZE] ^= random();
+        memcpy(var_vec, var_ref, TEST_MAP_SIZE);
+
+        // the byte loop calibrate_case did before
+        u32 ref = 0;
+        for (u32 i = 0; i < TEST_MAP_SIZE; ++i) {
+            if (!var_ref[i] && first[i] != cur_map[i]) {
+                var_ref[i] = 1;
+                vir_ref[i] = 0;
+                ++ref;
+            }
+        }
+
+        assert_int_equal(ref, skim_var_bytes(var_vec, vir_vec, first, cur_map,
+                                             cur_map + TEST_MAP_SIZE));
+        assert_memory_equal(var_ref, var_vec, TEST_MAP_SIZE);
+        assert_memory_equal(vir_ref, vir_vec, TEST_MAP_SIZE);
+
+    }
+
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_has_few_bits_codes),
+        cmocka_unit_test(test_has_few_bits_untouched),
+        cmocka_unit_test(test_has_few_bits_sparse),
+        cmocka_unit_test(test_edge_hits),
+        cmocka_unit_test(test_classify_decrease),
+        cmocka_unit_test(test_nonzero),
+        cmocka_unit_test(test_var_bytes)
+    };
+
+    //return cmocka_run_group_tests (tests, setup, teardown);
+    __real_exit( cmocka_run_group_tests (tests, NULL, NULL) );
+
+    // fake return for dumb compilers
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <assert.h>
+#include <cmocka.h>
+/* cmocka < 1.0 didn't support these features we need */
+#ifndef assert_ptr_equal
+#define assert_ptr_equal(a, b) \
+    _assert_int_equal(cast_ptr_to_largest_integral_type(a), \
+                      cast_ptr_to_largest_integral_type(b), \
+                      __FILE__, __LINE__)
+#define CMUnitTest UnitTest
+#define cmocka_unit_test unit_test
+#define cmocka_run_group_tests(t, setup, teardown) run_tests(t)
+#endif
+
+
+extern void mock_assert(const int result, const char* const expression,
+                        const char * const file, const int line);
+#undef assert
+#define assert(expression) \
+    mock_assert((int)(expression), #expression, __FILE__, __LINE__);
+
+#include "sampler.h"
+
+#include <stdlib.h>
+
+/* remap exit -> assert, then use cmocka's mock_assert
+    (compile with `--wrap=exit`) */
+extern void exit(int status);
+extern void __real_exit(int status);
+void __wrap_exit(int status);
+void __wrap_exit(int status) {
+    (void)status;
+    assert(0);
+}
+
+/* ignore all printfs */
+#undef printf
+extern int printf(const char *format, ...);
+extern int __real_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...);
+int __wrap_printf(const char *format, ...) {
+    (void)format;
+    return 1;
+}
+
+#define TEST_IDS 777
+
+static double weights[TEST_IDS];
+
+/* Mostly small weights, some large, some 0 as for disabled entries */
+static void fill_weights(u32 seed) {
+
+    srandom(seed);
+
+    for (u32 i = 0; i < TEST_IDS; ++i) {
+        u32 r = random() % 100;
+        weights[i] = r < 10 ? 0 : r < 25 ? 5 + random() % 50 : 1 + random() % 5;
+    }
+
+    weights[0] = 0;
+
+}
+
+/* The id a linear walk over the prefix sums lands on */
+static u32 pick_ref(u32 cnt, double r) {
+
+    double total = 0, target, sum = 0;
+
+    for (u32 i = 0; i < cnt; ++i) total += weights[i];
+    target = r * total;
+
+    for (u32 i = 0; i < cnt; ++i) {
+        sum += weights[i];
+        if (sum > target) return i;
+    }
+
+    return cnt;
+
+}
+
+static void test_build_push(void **state) {
+    (void)state;
+
+    struct sampler built = {0}, pushed = {0};
+
+    fill_weights(1);
+    sampler_build(&built, weights, TEST_IDS);
+    for (u32 i = 0; i < TEST_IDS; ++i) sampler_push(&pushed, weights[i]);
+
+    assert_int_equal(built.cnt, pushed.cnt);
+    for (u32 i = 1; i <= TEST_IDS; ++i) assert_true(built.tree[i] == pushed.tree[i]);
+    assert_true(built.total == pushed.total);
+
+    sampler_free(&built);
+    sampler_free(&pushed);
+
+}
+
+static void test_pick(void **state) {
+    (void)state;
+
+    struct sampler s = {0};
+
+    fill_weights(2);
+
+    // Also while growing, every size up to TEST_IDS has its own layout
+    for (u32 n = 0; n < TEST_IDS; ++n) {
+
+        sampler_push(&s, weights[n]);
+        if (!s.total) continue;
+
+        for (u32 k = 0; k < 64; ++k) {
+            double r = (double)random() / ((double)RAND_MAX + 1);
+            assert_int_equal(sampler_pick(&s, r), pick_ref(n + 1, r));
+        }
+
+    }
+
+    sampler_free(&s);
+
+}
+
+static void test_set(void **state) {
+    (void)state;
+
+    struct sampler s = {0};
+
+    fill_weights(3);
+    sampler_build(&s, weights, TEST_IDS);
+
+    for (u32 n = 0; n < 4 * TEST_IDS; ++n) {
+
+        u32 id = random() % TEST_IDS;
+        weights[id] = random() % 3 ? random() % 20 : 0;
+        sampler_set(&s, id, weights[id]);
+
+        double r = (double)random() / ((double)RAND_MAX + 1);
+        assert_int_equal(sampler_pick(&s, r), pick_ref(TEST_IDS, r));
+
+    }
+
+    sampler_free(&s);
+
+}
+
+/* Fractional weights set over and over leave the sums a little off.
+   Ids of weight 0 must still never come out, and live must say when
+   total is only rounding */
+static void test_drift(void **state) {
+    (void)state;
+
+    struct sampler s = {0};
+    u32 live = 0;
+
+    srandom(5);
+    for (u32 i = 0; i < TEST_IDS; ++i) sampler_push(&s, 1.0 / (1 + random() % 97));
+
+    // A weight far above the rest takes the low bits of the sums with it
+    for (u32 n = 0; n < 64 * TEST_IDS; ++n) {
+        u32 id = random() % TEST_IDS;
+        sampler_set(&s, id, random() % 4 ? 1.0 / (1 + random() % 97) : 0);
+        if (n % TEST_IDS == 0) {
+            sampler_set(&s, id, 1e17);
+            sampler_set(&s, id, 0);
+        }
+    }
+    assert_true(s.updates > 0 && s.updates <= 64 * TEST_IDS);
+
+    for (u32 i = 0; i < TEST_IDS; ++i) live += s.w[i] > 0;
+    assert_int_equal(s.live, live);
+
+    for (u32 k = 0; k < 64 * TEST_IDS; ++k) {
+        double r = (double)random() / ((double)RAND_MAX + 1);
+        u32 id = sampler_pick(&s, r);
+        assert_true(id == TEST_IDS || s.w[id] > 0);
+    }
+
+    for (u32 i = 0; i < TEST_IDS; ++i) sampler_set(&s, i, 0);
+    assert_int_equal(s.live, 0);
+    for (u32 k = 0; k < 64; ++k)
+        assert_int_equal(sampler_pick(&s, (double)random() / ((double)RAND_MAX + 1)), TEST_IDS);
+
+    // A build starts the count over
+    fill_weights(6);
+    sampler_build(&s, weights, TEST_IDS);
+    live = 0;
+    for (u32 i = 0; i < TEST_IDS; ++i) live += weights[i] > 0;
+    assert_int_equal(s.live, live);
+    assert_int_equal(s.updates, 0);
+
+    sampler_free(&s);
+
+}
+
+/* Evenly spaced r must hit each id in proportion to its weight, which
+   is what the alias table draws with, and ids of weight 0 never */
+static void test_proportional(void **state) {
+    (void)state;
+
+    struct sampler s = {0};
+    double total = 0;
+    u32 draws = TEST_IDS * 1000;
+    u32 *hits = calloc(TEST_IDS + 1, sizeof(u32));
+
+    fill_weights(4);
+    sampler_build(&s, weights, TEST_IDS);
+    for (u32 i = 0; i < TEST_IDS; ++i) total += weights[i];
+
+    for (u32 k = 0; k < draws; ++k) ++hits[sampler_pick(&s, (k + 0.5) / draws)];
+
+    assert_int_equal(hits[TEST_IDS], 0);
+    for (u32 i = 0; i < TEST_IDS; ++i) {
+        double expect = weights[i] / total * draws;
+        if (!weights[i]) assert_int_equal(hits[i], 0);
+        assert_true(hits[i] >= expect - 1 && hits[i] <= expect + 1);
+    }
+
+    free(hits);
+    sampler_free(&s);
+
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_build_push),
+        cmocka_unit_test(test_pick),
+        cmocka_unit_test(test_set),
+        cmocka_unit_test(test_drift),
+        cmocka_unit_test(test_proportional)
+    };
+
+    //return cmocka_run_group_tests (tests, setup, teardown);
+    __real_exit( cmocka_run_group_tests (tests, NULL, NULL) );
+
+    // fake return for dumb compilers
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*
+   IgorFuzz - queue sampler microbenchmark
+   ---------------------------------------
+
+   Grows a queue one entry at a time, as a reduction run does, and
+   keeps a weighted sampler over it up to date after every new entry:
+   once with a full Vose alias table rebuild as create_alias_table
+   does, once with the Fenwick tree of IGORFUZZ_FENWICK. Each update is
+   followed by a few draws and by touching a few weights, which is what
+   happens between two finds.
+
+   Then both samplers draw from the same final weights, and the total
+   variation distance of the draws to the weights tells whether they
+   sample alike.
+
+   Usage: ./bench-sampler [entries] [draws per entry]
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at:
+
+     https://www.apache.org/licenses/LICENSE-2.0
+
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sampler.h"
+
+#define TOUCHED_PER_ENTRY 4
+#define CHECK_ENTRIES     1000
+#define CHECK_DRAWS       10000000
+
+#define SEED 0x9e3779b97f4a7c15ULL
+
+// Separate streams, so both runs touch the same weights alike
+static u64 draw_rng = SEED, touch_rng = SEED;
+
+static inline u64 rng_next(u64 *state) {
+
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+
+}
+
+static inline double rng_percent(void) {
+
+  return (double)(rng_next(&draw_rng) >> 11) / (double)(1ULL << 53);
+
+}
+
+static double now_ms(void) {
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+
+}
+
+/* What the weights of compute_weight look like: mostly close to one,
+   some favored at five times that, the odd disabled one at zero. */
+
+static double random_weight(void) {
+
+  u64 r = rng_next(&touch_rng);
+  double f = (double)(r >> 11) / (double)(1ULL << 53);
+
+  if (r % 100 < 5) { return 0; }
+  if (r % 100 < 20) { return 5 * (0.1 + f); }
+  return 0.1 + f;
+
+}
+
+/* The Vose alias table of create_alias_table, given P[i] * n / sum. */
+
+struct alias {
+
+  u32    *table;
+  double *prob, *P;
+  int    *S, *L;
+
+};
+
+static void alias_build(struct alias *a, const double *w, u32 n) {
+
+  double sum = 0;
+  int    nS = 0, nL = 0, s;
+  u32    i, l, g;
+
+  a->table = realloc(a->table, n * sizeof(u32));
+  a->prob = realloc(a->prob, n * sizeof(double));
+  a->P = realloc(a->P, n * sizeof(double));
+  a->S = realloc(a->S, n * sizeof(int));
+  a->L = realloc(a->L, n * sizeof(int));
+
+  memset(a->table, 0, n * sizeof(u32));
+  memset(a->prob, 0, n * sizeof(double));
+
+  for (i = 0; i < n; ++i) {
+
+    sum += w[i];
+
+  }
+
+  for (i = 0; i < n; ++i) {
+
+    a->P[i] = (w[i] * n) / sum;
+
+  }
+
+  for (s = (s32)n - 1; s >= 0; --s) {
+
+    if (a->P[s] < 1) {
+
+      a->S[nS++] = s;
+
+    } else {
+
+      a->L[nL++] = s;
+
+    }
+
+  }
+
+  while (nS && nL) {
+
+    l = a->S[--nS];
+    g = a->L[--nL];
+    a->prob[l] = a->P[l];
+    a->table[l] = g;
+    a->P[g] = a->P[g] + a->P[l] - 1;
+    if (a->P[g] < 1) {
+
+      a->S[nS++] = g;
+
+    } else {
+
+      a->L[nL++] = g;
+
+    }
+
+  }
+
+  while (nL)
+    a->prob[a->L[--nL]] = 1;
+
+  while (nS)
+    a->prob[a->S[--nS]] = 1;
+
+}
+
+static inline u32 alias_pick(struct alias *a, u32 n) {
+
+  u32    s = rng_next(&draw_rng) % n;
+  double p = rng_percent();
+
+  return p < a->prob[s] ? s : a->table[s];
+
+}
+
+/* Total variation distance between draws and weights. */
+
+static double tv_distance(const u64 *hits, const double *w, u32 n,
+                          u64 draws) {
+
+  double sum = 0, tv = 0;
+  u32    i;
+
+  for (i = 0; i < n; ++i) {
+
+    sum += w[i];
+
+  }
+
+  for (i = 0; i < n; ++i) {
+
+    double d = (double)hits[i] / draws - w[i] / sum;
+    tv += d < 0 ? -d : d;
+
+  }
+
+  return tv / 2;
+
+}
+
+int main(int argc, char **argv) {
+
+  u32 entries = argc > 1 ? atoi(argv[1]) : 20000;
+  u32 draws = argc > 2 ? atoi(argv[2]) : 16;
+  u32 i, j, n;
+  volatile u64 sink = 0;  // keeps the draws
+
+  if (entries < 1 || entries > (1U << 28) || draws < 1) {
+
+    fprintf(stderr, "Usage: %s [entries] [draws per entry]\n", argv[0]);
+    return 1;
+
+  }
+
+  double *w0 = malloc(entries * sizeof(double));
+  double *w = malloc(entries * sizeof(double));
+  for (i = 0; i < entries; ++i) {
+
+    w0[i] = random_weight();
+
+  }
+
+  w0[0] = 1;  // never nothing to draw
+  u64 touch_seed = touch_rng;
+
+  struct alias   a = {0};
+  struct sampler s = {0};
+  double         start, alias_ms, fenwick_ms;
+
+  // An alias table rebuild per new entry
+  memcpy(w, w0, entries * sizeof(double));
+  start = now_ms();
+  for (n = 1; n <= entries; ++n) {
+
+    for (j = 0; j < TOUCHED_PER_ENTRY; ++j) {
+
+      u32 t = rng_next(&touch_rng) % n;
+      if (t) { w[t] = random_weight(); }
+
+    }
+
+    alias_build(&a, w, n);
+    for (j = 0; j < draws; ++j) {
+
+      sink += alias_pick(&a, n);
+
+    }
+
+  }
+
+  alias_ms = now_ms() - start;
+
+  // A Fenwick push per new entry, and a set per touched one
+  memcpy(w, w0, entries * sizeof(double));
+  touch_rng = touch_seed;
+  start = now_ms();
+  for (n = 1; n <= entries; ++n) {
+
+    sampler_push(&s, w[n - 1]);
+    for (j = 0; j < TOUCHED_PER_ENTRY; ++j) {
+
+      u32 t = rng_next(&touch_rng) % n;
+      if (t) { sampler_set(&s, t, w[t] = random_weight()); }
+
+    }
+
+    for (j = 0; j < draws; ++j) {
+
+      sink += sampler_pick(&s, rng_percent());
+
+    }
+
+  }
+
+  fenwick_ms = now_ms() - start;
+
+  printf("%u entries, %u draws and %u touched weights per new entry\n",
+         entries, draws, TOUCHED_PER_ENTRY);
+  printf("  alias rebuilds: %10.1f ms\n", alias_ms);
+  printf("  fenwick:        %10.1f ms  (%.1fx)\n", fenwick_ms,
+         alias_ms / fenwick_ms);
+
+  // Both draw from the same weights as often as each other
+  n = entries < CHECK_ENTRIES ? entries : CHECK_ENTRIES;
+  u64 *hits_a = calloc(n, sizeof(u64)), *hits_f = calloc(n, sizeof(u64));
+
+  alias_build(&a, w, n);
+  sampler_build(&s, w, n);
+
+  for (i = 0; i < CHECK_DRAWS; ++i) {
+
+    ++hits_a[alias_pick(&a, n)];
+
+    do {
+
+      j = sampler_pick(&s, rng_percent());
+
+    } while (j >= n);
+
+    ++hits_f[j];
+
+  }
+
+  printf("  TV distance to the weights over %u entries, %u draws:\n", n,
+         CHECK_DRAWS);
+  printf("    alias %.5f  fenwick %.5f\n", tv_distance(hits_a, w, n, CHECK_DRAWS),
+         tv_distance(hits_f, w, n, CHECK_DRAWS));
+
+  free(hits_a);
+  free(hits_f);
+  free(a.table);
+  free(a.prob);
+  free(a.P);
+  free(a.S);
+  free(a.L);
+  sampler_free(&s);
+  free(w);
+  free(w0);
+
+  return 0;
+
+}
+
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# IgorFuzz - queue store export
+# -----------------------------
+#
+# Writes the entries of the append-only queue store of IGORFUZZ_STORE
+# to <out_dir>/queue/, as afl-fuzz does itself at the end of a run.
+# Use it on the output directory of a run that was killed, before
+# collecting its findings. Resuming it in place exports it by itself.
+#
+# Every index line is "<offset> <length> <name>"; a trimmed entry has
+# more than one, the last one is its current version. Names are relative
+# to queue/, and one with a directory, like .state/dominated/<name> for
+# IGORFUZZ_PARETO_MOVE, means the file moved there from queue/.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at:
+#
+#   https://www.apache.org/licenses/LICENSE-2.0
+#
+
+if [ ! "$#" = "1" ]; then
+
+  echo "Usage: $0 <out_dir>" 1>&2
+  echo 1>&2
+  echo "<out_dir> is the directory with queue.store and queue.idx, e.g." 1>&2
+  echo "out/default, or out/default/pocs/<name> for a pool of PoCs." 1>&2
+  exit 1
+
+fi
+
+DIR="$1"
+
+if [ ! -f "$DIR/queue.store" -o ! -f "$DIR/queue.idx" ]; then
+
+  echo "[-] Error: no queue store in '$DIR'." 1>&2
+  exit 1
+
+fi
+
+mkdir -p "$DIR/queue" || exit 1
+
+COUNT=0
+
+while read -r OFF LEN NAME; do
+
+  case "$NAME" in
+    */*)
+      mkdir -p "$DIR/queue/${NAME%/*}" || exit 1
+      rm -f "$DIR/queue/${NAME##*/}"
+      ;;
+  esac
+
+  # Seeks straight to the record, rather than reading the store up to it
+  dd if="$DIR/queue.store" of="$DIR/queue/$NAME" bs=65536 \
+    iflag=skip_bytes,count_bytes skip="$OFF" count="$LEN" status=none || exit 1
+  COUNT=$((COUNT + 1))
+
+done <"$DIR/queue.idx"
+
+echo "[+] Exported $COUNT records to '$DIR/queue'."